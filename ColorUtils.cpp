@@ -11,7 +11,7 @@
 // 201-step fixed bit brightness table: gamma = 2.4
 // Modified gamma table with linear input from 0.06 to 1.000 
 // First value manually set to 0
-static const int32_t PROGMEM fixed_gamma_table[201] = {
+const int32_t PROGMEM fixed_gamma_table[201] = {
     0, 1, 2, 2, 2, 3, 3, 3, 4, 4, 5, 5, 6, 6, 7, 8,
     8, 9, 10, 11, 11, 12, 13, 14, 15, 16, 17, 18, 19, 21, 22, 23,
     24, 26, 27, 28, 30, 31, 33, 34, 36, 38, 39, 41, 43, 45, 47, 49,
@@ -29,7 +29,7 @@ static const int32_t PROGMEM fixed_gamma_table[201] = {
 
 // 201-step fixed bit saturation table table: pow(1/3)
 // From: 0 - 1024 stepping by 0.005
-static const int32_t PROGMEM fixed_sat_table[201] = {
+const int32_t PROGMEM fixed_sat_table[201] = {
     0, 175, 221, 253, 278, 299, 318, 335, 350, 364, 377, 389, 401, 412, 422, 432,
     441, 450, 459, 467, 475, 483, 491, 498, 505, 512, 519, 525, 532, 538, 544, 550,
     556, 562, 567, 573, 578, 583, 589, 594, 599, 604, 609, 613, 618, 623, 627, 632,
@@ -45,41 +45,6 @@ static const int32_t PROGMEM fixed_sat_table[201] = {
     1010, 1012, 1014, 1015, 1017, 1019, 1021, 1022, 1024
 };
 
-#define FIXED_BITS 10
-#define FIXED(x) ((x) << FIXED_BITS)
-#define UNFIXED(x) ((x) >> FIXED_BITS)
-#define UNFIXED2(x) ((x) >> (FIXED_BITS * 2))
-
-// Fixed point about 3x faster than floating point with gamma / sat lookup
-// And as much as 7x faster than using pow to calculate gamma / sat.
-
-SPixelRec ColorUtils::HSVtoPixel(SHSVRec hsv) {
-    int32_t     h1 = (int32_t)(hsv.hue * ((float)FIXED(1) / 120.0f)) % FIXED(3);
-    int32_t     lG = pgm_read_dword(&fixed_gamma_table[(int)(hsv.val * 200.0 + 0.5)]);
-    int32_t     adjSat = pgm_read_dword(&fixed_sat_table[(int)(hsv.sat * 200.0 + 0.5)]);
-    int32_t     cMult = UNFIXED(lG * adjSat * 256); // from 0 - 256 * FIXED_MULT
-    SPixelRec   pixel;
-
-    if (h1 < FIXED(1)) {        // 0 - 120°
-        pixel.comp.r = UNFIXED2(max(0, cMult * (FIXED(1) - h1) - 1));
-        pixel.comp.g = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(1))) - 1));
-        pixel.comp.b = 0;
-    }
-    else if (h1 < FIXED(2)) {   // 120° - 240°
-        pixel.comp.r = 0;
-        pixel.comp.g = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(1))) - 1));
-        pixel.comp.b = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(2))) - 1));
-    }
-    else {                      // 240° - 360°
-        pixel.comp.r = UNFIXED2(max(0, cMult * (h1 - FIXED(2)) - 1));
-        pixel.comp.g = 0;
-        pixel.comp.b = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(2))) - 1));
-    }
-    pixel.comp.w = UNFIXED2(max(0, (lG * (FIXED(1) - adjSat) * 256) - 1));
-
-    return pixel;
-}
-
 // The usual method of converting HSV to RGB (https://en.wikipedia.org/wiki/HSL_and_HSV#HSV_to_RGB)
 // pegs the primaries to 1 over a 120° span which causes an increase in brightness as channels mix
 // over various hues.
@@ -123,6 +88,58 @@ SHSVRec ColorUtils::mix(SHSVRec x, SHSVRec y, float a) {
     return mixed;
 }
 
+// Precomputed pixels for effects that only vary value (or hue) across an area so
+// the per pixel work is a table lookup. Ramps run from val 0 to color's val and
+// from hue through one full turn respectively.
+
+void ColorUtils::valueRamp(SHSVRec color, SPixelRec *ramp, uint16_t count) {
+    float   baseVal = color.val;
+
+    for (uint16_t i=0; i<count; i++) {
+        ramp[i] = HSVtoPixel(color.withVal(baseVal * (float)i / (float)(count - 1)));
+    }
+}
+
+void ColorUtils::hueRamp(float hue, float sat, float val, SPixelRec *ramp, uint16_t count) {
+    for (uint16_t i=0; i<count; i++) {
+        ramp[i] = HSVtoPixel(SHSVRec(fmodf(hue + 360.0f * (float)i / (float)count, 360.0f), sat, val));
+    }
+}
+
+// Evenly spaced stops, hue taking the short way around between each pair. A
+// cyclic ramp blends the last stop back into the first so it can wrap.
+
+void ColorUtils::gradientRamp(const SHSVRec *stops, uint8_t stopCount, bool cyclic, SPixelRec *ramp, uint16_t count) {
+    uint8_t     segments = cyclic ? stopCount : stopCount - 1;
+    float       scale = segments > 0 ? (float)segments / (float)(cyclic ? count : max(1, count - 1)) : 0.0f;
+
+    for (uint16_t i=0; i<count; i++) {
+        float       where = i * scale;
+        uint8_t     seg = min((uint8_t)where, (uint8_t)(max((uint8_t)1, segments) - 1));
+        float       a = where - seg;
+        SHSVRec     from = stops[seg];
+        SHSVRec     to = stops[(seg + 1) % stopCount];
+        float       hueDelta = to.hue - from.hue;
+        SHSVRec     color = ColorUtils::mix(from, to, a);
+
+        if (hueDelta > 180.0f) {
+            hueDelta -= 360.0f;
+        }
+        else if (hueDelta < -180.0f) {
+            hueDelta += 360.0f;
+        }
+        color.hue = from.hue + hueDelta * a;
+        if (color.hue < 0.0f) {
+            color.hue += 360.0f;
+        }
+        else if (color.hue >= 360.0f) {
+            color.hue -= 360.0f;
+        }
+
+        ramp[i] = HSVtoPixel(color);
+    }
+}
+
 SHSVRec ColorUtils::none   = { 0.0, 0.0, -1.0 };
 SHSVRec ColorUtils::black   = { 0.0, 0.0, 0.0 };
 SHSVRec ColorUtils::white   = { 0.0, 0.0, 1.0 };
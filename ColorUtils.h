@@ -31,6 +31,7 @@ typedef struct SHSVRec {
     
     SHSVRec withVal(float inVal) { SHSVRec copy = *this; copy.val = inVal; return copy; }
     bool valid() { return val != -1.0; }
+    SHSVRec clamped() { SHSVRec copy = *this; copy.sat = constrain(sat, 0.0f, 1.0f); copy.val = constrain(val, 0.0f, 1.0f); return copy; }   // e.g. none (val -1) for an area never colored
 
 } SHSVRec;
 
@@ -41,6 +42,19 @@ public:
     static uint32_t ColorHSV(uint16_t hue, uint8_t sat, uint8_t val);
 
     static SHSVRec mix(SHSVRec x, SHSVRec y, float a);
+    static inline SPixelRec blend(SPixelRec x, SPixelRec y, int32_t weight) {     // weight 0 - 256
+        SPixelRec   pixel;
+
+        pixel.comp.g = x.comp.g + (((y.comp.g - x.comp.g) * weight) >> 8);
+        pixel.comp.r = x.comp.r + (((y.comp.r - x.comp.r) * weight) >> 8);
+        pixel.comp.b = x.comp.b + (((y.comp.b - x.comp.b) * weight) >> 8);
+        pixel.comp.w = x.comp.w + (((y.comp.w - x.comp.w) * weight) >> 8);
+
+        return pixel;
+    }
+    static void valueRamp(SHSVRec color, SPixelRec *ramp, uint16_t count);
+    static void hueRamp(float hue, float sat, float val, SPixelRec *ramp, uint16_t count);
+    static void gradientRamp(const SHSVRec *stops, uint8_t stopCount, bool cyclic, SPixelRec *ramp, uint16_t count);
 
     static SHSVRec none;
     static SHSVRec black;
@@ -54,4 +68,48 @@ public:
     static SHSVRec magenta;
 };
 
+extern const int32_t PROGMEM fixed_gamma_table[201];
+extern const int32_t PROGMEM fixed_sat_table[201];
+
+#define FIXED_BITS 10
+#define FIXED(x) ((x) << FIXED_BITS)
+#define UNFIXED(x) ((x) >> FIXED_BITS)
+#define UNFIXED2(x) ((x) >> (FIXED_BITS * 2))
+
+// Fixed point about 3x faster than floating point with gamma / sat lookup
+// And as much as 7x faster than using pow to calculate gamma / sat.
+// Inline so effect render loops can be compiled into a single pass.
+
+inline SPixelRec ColorUtils::HSVtoPixel(SHSVRec hsv) {
+    int32_t     h1 = (int32_t)(hsv.hue * ((float)FIXED(1) / 120.0f)) % FIXED(3);
+    int32_t     lG = pgm_read_dword(&fixed_gamma_table[(int)(hsv.val * 200.0 + 0.5)]);
+    int32_t     adjSat = pgm_read_dword(&fixed_sat_table[(int)(hsv.sat * 200.0 + 0.5)]);
+    int32_t     cMult = UNFIXED(lG * adjSat * 256); // from 0 - 256 * FIXED_MULT
+    SPixelRec   pixel;
+
+    if (h1 < FIXED(1)) {        // 0 - 120°
+        pixel.comp.r = UNFIXED2(max(0, cMult * (FIXED(1) - h1) - 1));
+        pixel.comp.g = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(1))) - 1));
+        pixel.comp.b = 0;
+    }
+    else if (h1 < FIXED(2)) {   // 120° - 240°
+        pixel.comp.r = 0;
+        pixel.comp.g = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(1))) - 1));
+        pixel.comp.b = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(2))) - 1));
+    }
+    else {                      // 240° - 360°
+        pixel.comp.r = UNFIXED2(max(0, cMult * (h1 - FIXED(2)) - 1));
+        pixel.comp.g = 0;
+        pixel.comp.b = UNFIXED2(max(0, cMult * (FIXED(1) - abs(h1 - FIXED(2))) - 1));
+    }
+    pixel.comp.w = UNFIXED2(max(0, (lG * (FIXED(1) - adjSat) * 256) - 1));
+
+    return pixel;
+}
+
+#undef FIXED_BITS
+#undef FIXED
+#undef UNFIXED
+#undef UNFIXED2
+
 #endif
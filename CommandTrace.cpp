@@ -0,0 +1,371 @@
+//
+//  CommandTrace.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "CommandTrace.h"
+#include "NetworkMgr.h"
+#include "LoopScheduler.h"
+#include "config.h"
+
+#define kTRACE_REPORT_LEN       768
+
+CommandTrace gCommandTrace;
+
+static const char *const sourceNames[trace_source_count] = { "mqtt", "restore", "web" };
+
+CommandTrace::CommandTrace() {
+    request = trace_req_none;
+    requestPath[0] = 0;
+    requestSpeed = 1.0;
+    memset(&header, 0, sizeof(header));
+    recordStart = 0;
+    dropped = 0;
+    stage = nullptr;
+    stageUsed = 0;
+    hasPending = false;
+    replayBuffer = nullptr;
+    speed = 1.0;
+    replayed = 0;
+}
+
+// The request calls only check what they can without touching the filesystem,
+// the rest is reported by loop() on Serial
+
+bool CommandTrace::requestRecord(const char *path) {
+    if (request != trace_req_none || recordFile || replayFile || strlen(path) >= sizeof(requestPath)) {
+        return false;
+    }
+
+    strlcpy(requestPath, path, sizeof(requestPath));
+    request = trace_req_record;
+
+    return true;
+}
+
+bool CommandTrace::requestReplay(const char *path, float speed) {
+    if (request != trace_req_none || recordFile || replayFile || strlen(path) >= sizeof(requestPath)) {
+        return false;
+    }
+
+    strlcpy(requestPath, path, sizeof(requestPath));
+    requestSpeed = speed;
+    request = trace_req_replay;
+
+    return true;
+}
+
+void CommandTrace::requestStop() {
+    request = trace_req_stop;       // also cancels a start that hasn't happened yet
+}
+
+bool CommandTrace::beginRecord(const char *path) {
+    if (recordFile || replayFile) {
+        return false;
+    }
+
+    if ((stage = (uint8_t *)malloc(kTRACE_STAGE_LEN)) == nullptr || !(recordFile = LittleFS.open(path, "w"))) {
+        free(stage);
+        stage = nullptr;
+        return false;
+    }
+
+    header.magic = kTRACE_MAGIC;
+    header.version = kTRACE_VERSION;
+    header.reserved = 0;
+    header.recordCount = 0;
+    header.duration = 0;
+    recordFile.write((const uint8_t *)&header, sizeof(header));
+
+    recordStart = millis();
+    dropped = 0;
+    stageUsed = 0;
+    Serial.print(F("Trace recording to ")); Serial.println(path);
+
+    return true;
+}
+
+// Retained state only counts while it's the restore we're waiting on, which
+// is published to the endpoint itself
+
+void CommandTrace::recordMQTT(const char *topic, const uint8_t *payload, unsigned int length, bool restore) {
+    uint8_t     *dst;
+
+    if (!recordFile || (restore && strcmp(topic, kMQTT_ENDPOINT))) {
+        return;
+    }
+
+    if (restore) {
+        dst = stageRecord(trace_restore, nullptr, 0, length);
+    }
+    else {
+        dst = stageRecord(trace_mqtt, topic, strlen(topic), length);
+    }
+
+    if (dst != nullptr) {
+        memcpy(dst, payload, length);
+    }
+}
+
+void CommandTrace::recordWeb(const JsonDocument &json) {
+    size_t      length;
+    uint8_t     *dst;
+
+    if (!recordFile) {
+        return;
+    }
+
+    length = measureJson(json);
+    if ((dst = stageRecord(trace_web, nullptr, 0, length)) != nullptr) {
+        serializeJson(json, (char *)dst, length + 1);       // stageRecord leaves room for the terminator
+    }
+}
+
+// Reserves a record in the staging buffer and returns where its payload goes,
+// or nullptr if it doesn't fit (counted as dropped)
+
+uint8_t *CommandTrace::stageRecord(uint8_t source, const char *topic, size_t topicLen, size_t payloadLen) {
+    TraceRecordRec  record;
+    size_t          recordLen = sizeof(record) + topicLen + payloadLen;
+    uint8_t         *dst = stage + stageUsed;
+
+    if (topicLen > kTRACE_MAX_TOPIC || payloadLen > kTRACE_MAX_PAYLOAD || stageUsed + recordLen + 1 > kTRACE_STAGE_LEN) {
+        dropped++;
+        return nullptr;
+    }
+
+    record.time = millis() - recordStart;
+    record.source = source;
+    record.topicLen = topicLen;
+    record.payloadLen = payloadLen;
+    memcpy(dst, &record, sizeof(record));
+    memcpy(dst + sizeof(record), topic, topicLen);
+
+    stageUsed += recordLen;
+    header.recordCount++;
+
+    return dst + sizeof(record) + topicLen;
+}
+
+void CommandTrace::flush() {
+    if (recordFile && stageUsed > 0) {
+        recordFile.write(stage, stageUsed);
+        stageUsed = 0;
+    }
+}
+
+// speed scales the recorded timing, 0 replays as fast as the slice allows
+
+bool CommandTrace::beginReplay(const char *path, float inSpeed) {
+    if (recordFile || replayFile) {
+        return false;
+    }
+
+    if ((replayBuffer = (char *)malloc(kTRACE_MAX_TOPIC + kTRACE_MAX_PAYLOAD + 2)) == nullptr || !(replayFile = LittleFS.open(path, "r")) ||
+        replayFile.read((uint8_t *)&header, sizeof(header)) != sizeof(header) || header.magic != kTRACE_MAGIC || header.version != kTRACE_VERSION) {
+        replayFile.close();
+        free(replayBuffer);
+        replayBuffer = nullptr;
+        return false;
+    }
+
+    speed = max(inSpeed, 0.0f);
+    hasPending = false;
+    replayed = 0;
+    memset(bySource, 0, sizeof(bySource));
+    heapChange = 0;
+    heapShrunk = 0;
+    memset(&handlerStats, 0, sizeof(handlerStats));
+    memset(&tickStats, 0, sizeof(tickStats));
+
+    replayStart = millis();
+    lastTick = gPixels->getTick();
+    startFrames = gLoopScheduler.getFrameStats().frames;
+    startMissed = gLoopScheduler.getFrameStats().missed;
+    heapStart = heapMin = ESP.getFreeHeap();
+    Serial.printf_P(PSTR("Trace replay: %u records over %us\n"), header.recordCount, header.duration / 1000);
+
+    return true;
+}
+
+void CommandTrace::loop() {
+    switch (request) {
+        case trace_req_record:
+            if (!beginRecord(requestPath)) {
+                Serial.print(F("Trace recording failed: ")); Serial.println(requestPath);
+            }
+            break;
+
+        case trace_req_replay:
+            if (!beginReplay(requestPath, requestSpeed)) {
+                Serial.print(F("Trace replay failed: ")); Serial.println(requestPath);
+            }
+            break;
+
+        case trace_req_stop:
+            endRecord();
+            if (replayFile) {
+                finishReplay("stopped");
+            }
+            break;
+    }
+    request = trace_req_none;
+
+    flush();
+
+    if (!replayFile) {
+        return;
+    }
+
+    sample();
+
+    do {
+        if (!hasPending && !(hasPending = readRecord())) {
+            finishReplay(replayed == header.recordCount ? "complete" : "truncated");
+            return;
+        }
+        if (speed > 0.0 && millis() - replayStart < (uint32_t)(pending.time / speed)) {
+            break;
+        }
+
+        dispatch();
+        hasPending = false;
+    } while (!gLoopScheduler.shouldYield());
+}
+
+void CommandTrace::endRecord() {
+    if (recordFile) {
+        flush();
+
+        // Patch in the final count and duration
+        header.duration = millis() - recordStart;
+        recordFile.seek(0, SeekSet);
+        recordFile.write((const uint8_t *)&header, sizeof(header));
+        recordFile.close();
+        free(stage);
+        stage = nullptr;
+
+        Serial.printf_P(PSTR("Trace recorded %u records over %us, %u dropped\n"), header.recordCount, header.duration / 1000, dropped);
+    }
+}
+
+bool CommandTrace::readRecord() {
+    char    *topic = replayBuffer;
+    char    *payload;
+
+    if (replayFile.read((uint8_t *)&pending, sizeof(pending)) != sizeof(pending) ||
+        pending.source >= trace_source_count || pending.topicLen > kTRACE_MAX_TOPIC || pending.payloadLen > kTRACE_MAX_PAYLOAD) {
+        return false;
+    }
+
+    payload = topic + pending.topicLen + 1;
+    if (replayFile.read((uint8_t *)topic, pending.topicLen) != pending.topicLen ||
+        replayFile.read((uint8_t *)payload, pending.payloadLen) != pending.payloadLen) {
+        return false;
+    }
+    topic[pending.topicLen] = 0;
+    payload[pending.payloadLen] = 0;
+
+    return true;
+}
+
+// Through the same entry points the live traffic took. Heap is measured around
+// the handler only, effects themselves are built at the next tick.
+
+void CommandTrace::dispatch() {
+    char        *topic = replayBuffer;
+    char        *payload = replayBuffer + pending.topicLen + 1;
+    uint32_t    heapBefore = ESP.getFreeHeap();
+    uint32_t    start = micros();
+    int32_t     heapDelta;
+
+    if (pending.source == trace_mqtt) {
+        gNetworkMgr.mqttMonitor(topic, (byte *)payload, pending.payloadLen);
+    }
+    else {
+        StaticJsonDocument<256> jsonDoc;
+        DeserializationError    error = deserializeJson(jsonDoc, payload, pending.payloadLen);     // in place
+
+        if (error) {
+            Serial.print(F("deserializeJson() failed: "));
+            Serial.println(error.f_str());
+        }
+        else if (pending.source == trace_restore) {
+            gPixels->handleMQTTCommand(jsonDoc);
+        }
+        else {
+            gPixels->handleWebCommand(jsonDoc);
+        }
+    }
+
+    LoadTest::addSample(handlerStats, micros() - start);
+    heapDelta = (int32_t)ESP.getFreeHeap() - (int32_t)heapBefore;
+    heapChange += heapDelta;
+    if (heapDelta < 0) {
+        heapShrunk++;
+    }
+
+    bySource[pending.source]++;
+    replayed++;
+}
+
+void CommandTrace::sample() {
+    uint32_t    tick = gPixels->getTick();
+
+    if (tick == lastTick) {
+        return;
+    }
+    lastTick = tick;
+
+    LoadTest::addSample(tickStats, gPixels->getLastTickTime());
+    heapMin = min(heapMin, ESP.getFreeHeap());
+}
+
+void CommandTrace::finishReplay(const char *result) {
+    char    *report;
+    File    file;
+    size_t  reportLen;
+
+    replayFile.close();
+    free(replayBuffer);
+    replayBuffer = nullptr;
+
+    if ((report = (char *)malloc(kTRACE_REPORT_LEN)) != nullptr) {
+        reportLen = formatReport(result, report, kTRACE_REPORT_LEN);
+        Serial.println(report);
+        if ((file = LittleFS.open(kTRACE_REPORT_PATH, "w"))) {
+            file.write((const uint8_t *)report, reportLen);
+            file.close();
+        }
+        free(report);
+    }
+}
+
+size_t CommandTrace::formatReport(const char *result, char *buffer, size_t bufferLen) {
+    const SchedFrameStatsRec    &frame = gLoopScheduler.getFrameStats();
+    uint32_t                    elapsed = millis() - replayStart;
+    size_t                      len;
+
+    len = snprintf_P(buffer, bufferLen, PSTR("{ \"result\": \"%s\", \"elapsed\": %u, \"speed\": %u, \"commands\": %u, \"sources\": { "),
+        result, elapsed, (uint32_t)(speed * 100.0), replayed);
+    for (uint8_t source=0; source<trace_source_count && len < bufferLen; source++) {
+        len += snprintf_P(buffer + len, bufferLen - len, PSTR("%s\"%s\": %u"), source ? ", " : "", sourceNames[source], bySource[source]);
+    }
+    if (len < bufferLen) {
+        len += snprintf_P(buffer + len, bufferLen - len,
+            PSTR(" }, \"rate\": %u, \"handlerRate\": %u, \"handler\": { \"min\": %u, \"avg\": %u, \"max\": %u }, "
+                 "\"ticks\": { \"count\": %u, \"min\": %u, \"avg\": %u, \"max\": %u, \"frames\": %u, \"missed\": %u }, "
+                 "\"heap\": { \"start\": %u, \"min\": %u, \"end\": %u, \"perCommand\": %d, \"shrunk\": %u } }"),
+            elapsed ? (uint32_t)((uint64_t)replayed * 1000 / elapsed) : 0,
+            handlerStats.total ? (uint32_t)((uint64_t)replayed * 1000000 / handlerStats.total) : 0,
+            handlerStats.min, handlerStats.count ? (uint32_t)(handlerStats.total / handlerStats.count) : 0, handlerStats.max,
+            tickStats.count, tickStats.min, tickStats.count ? (uint32_t)(tickStats.total / tickStats.count) : 0, tickStats.max,
+            frame.frames - startFrames, frame.missed - startMissed,
+            heapStart, heapMin, ESP.getFreeHeap(), replayed ? heapChange / (int32_t)replayed : 0, heapShrunk);
+    }
+
+    return min(len, bufferLen - 1);
+}
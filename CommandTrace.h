@@ -0,0 +1,117 @@
+//
+//  CommandTrace.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef CommandTrace_h
+#define CommandTrace_h
+
+#include "LoadTest.h"
+#include "TraceFormat.h"
+#include <LittleFS.h>
+
+// Records the control traffic that actually arrives (HA slider bursts,
+// automations, retained restores) so it can be replayed later against a new
+// build on the same hardware.
+//
+// While recording, every inbound MQTT message and /$effect request is appended
+// to a RAM staging buffer (/$effect arrives in the AsyncTCP callbacks where we
+// shouldn't touch the filesystem) which loop() flushes to LittleFS. Messages
+// that don't fit are counted as dropped rather than blocking.
+//
+// The trace file format is described in TraceFormat.h. tools/trace_dump.cpp
+// prints a trace on a host.
+//
+// Replay feeds the records back through the same entry points, either at their
+// original timing (speed 1.0, or scaled) or as fast as the scheduler slice
+// allows (speed 0), and samples as it goes:
+//
+//  commands        count, wall clock rate and handler rate (commands per second of handler time)
+//  handler time    min / avg / max µS per command
+//  heap            net free heap change per command and commands that left the heap smaller
+//  tick time       min / avg / max µS of performTick, plus frames the scheduler missed
+//
+// The report is written to kTRACE_REPORT_PATH and Serial.
+//
+// /$trace?record=/evening.klt, /$trace?replay=/evening.klt&speed=fast, /$trace?stop=1
+//
+// Those come in from the AsyncTCP callbacks so they only post a request. The
+// files are opened, patched and closed by loop().
+
+#define kTRACE_REPORT_PATH      "/replay.json"
+#define kTRACE_STAGE_LEN        2048
+#define kTRACE_PATH_LEN         48
+
+enum {
+    trace_req_none = 0,
+    trace_req_record,
+    trace_req_replay,
+    trace_req_stop,
+};
+
+class CommandTrace {
+public:
+    CommandTrace();
+
+    bool requestRecord(const char *path);
+    bool requestReplay(const char *path, float speed);
+    void requestStop();
+    void loop();
+
+    void recordMQTT(const char *topic, const uint8_t *payload, unsigned int length, bool restore);
+    void recordWeb(const JsonDocument &json);
+
+    inline bool isRecording() { return recordFile; }
+    inline bool isReplaying() { return replayFile; }
+    inline uint32_t recordCount() { return recordFile ? header.recordCount : replayed; }
+
+private:
+    bool beginRecord(const char *path);
+    bool beginReplay(const char *path, float speed);
+    void endRecord();
+    uint8_t *stageRecord(uint8_t source, const char *topic, size_t topicLen, size_t payloadLen);
+    void flush();
+    bool readRecord();
+    void dispatch();
+    void sample();
+    void finishReplay(const char *result);
+    size_t formatReport(const char *result, char *buffer, size_t bufferLen);
+
+    uint8_t             request;
+    char                requestPath[kTRACE_PATH_LEN];
+    float               requestSpeed;
+
+    // recording
+    File                recordFile;
+    TraceHeaderRec      header;
+    uint32_t            recordStart;
+    uint32_t            dropped;
+    uint8_t             *stage;
+    uint16_t            stageUsed;
+
+    // replay
+    File                replayFile;
+    TraceRecordRec      pending;
+    bool                hasPending;
+    char                *replayBuffer;      // topic, then payload, each terminated
+    float               speed;
+    uint32_t            replayStart;
+    uint32_t            replayed;
+    uint32_t            bySource[trace_source_count];
+    int32_t             heapChange;
+    uint32_t            heapShrunk;
+    uint32_t            heapStart;
+    uint32_t            heapMin;
+    uint32_t            lastTick;
+    uint32_t            startFrames;
+    uint32_t            startMissed;
+    LoadStatRec         handlerStats;
+    LoadStatRec         tickStats;
+};
+
+extern CommandTrace gCommandTrace;
+
+#endif
@@ -0,0 +1,180 @@
+//
+//  FrameRecorder.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "FrameRecorder.h"
+
+FrameRecorder gFrameRecorder;
+
+FrameRecorder::FrameRecorder() {
+    beginRequested = false;
+    endRequested = false;
+    requestArea = 0;
+    requestFrames = 0;
+    requestTicks = 1;
+    requestPath[0] = 0;
+    areaID = 0;
+    framesLeft = 0;
+    lastTick = 0;
+    bytesWritten = 0;
+    curFrame = nullptr;
+    prevFrame = nullptr;
+    encodeBuffer = nullptr;
+    memset(&header, 0, sizeof(header));
+}
+
+bool FrameRecorder::begin(uint16_t inAreaID, uint16_t frames, const char *path, uint16_t frameTicks) {
+    PixelAreaPtr    area = gPixels->getArea(inAreaID);
+
+    end();
+    if (area->len <= 0 || frames == 0) {
+        return false;
+    }
+
+    // Worst case every pixel costs an op byte plus its value
+    curFrame = (SPixelPtr)calloc(area->len, sizeof(SPixelRec));
+    prevFrame = (SPixelPtr)calloc(area->len, sizeof(SPixelRec));
+    encodeBuffer = (uint8_t *)malloc(area->len * (sizeof(SPixelRec) + 1) + sizeof(uint16_t));
+    file = LittleFS.open(path, "w");
+
+    if (curFrame == nullptr || prevFrame == nullptr || encodeBuffer == nullptr || !file) {
+        end();
+        return false;
+    }
+
+    areaID = inAreaID;
+    framesLeft = frames;
+    lastTick = gPixels->getTick();
+    header.magic = kFRAME_MAGIC;
+    header.version = kFRAME_VERSION;
+    header.pixelCount = area->len;
+    header.frameTicks = max((uint16_t)1, frameTicks);
+    header.frameCount = 0;
+    bytesWritten = file.write((const uint8_t *)&header, sizeof(header));
+
+    return true;
+}
+
+// Checks what it can without the filesystem, begin() reports the rest on Serial.
+// Paths are limited to what PxlFX_Playback can be given.
+
+bool FrameRecorder::requestBegin(uint16_t inAreaID, uint16_t frames, const char *path, uint16_t frameTicks) {
+    if (beginRequested || inAreaID >= kMAX_PIXEL_AREAS || gPixels->getArea(inAreaID)->len <= 0 || frames == 0 ||
+        strlen(path) >= sizeof(requestPath)) {
+        return false;
+    }
+
+    strlcpy(requestPath, path, sizeof(requestPath));
+    requestArea = inAreaID;
+    requestFrames = frames;
+    requestTicks = frameTicks;
+    endRequested = false;
+    beginRequested = true;
+
+    return true;
+}
+
+void FrameRecorder::loop() {
+    uint32_t    tick;
+
+    if (endRequested) {
+        endRequested = false;
+        end();
+    }
+    if (beginRequested) {
+        beginRequested = false;
+        if (!begin(requestArea, requestFrames, requestPath, requestTicks)) {
+            Serial.print(F("Recording failed: ")); Serial.println(requestPath);
+        }
+    }
+
+    tick = gPixels->getTick();
+
+    if (!file || tick - lastTick < header.frameTicks) {
+        return;
+    }
+
+    PixelAreaPtr    area = gPixels->getArea(areaID);
+    uint16_t        *mapIdx = area->map;
+    SPixelPtr       swap;
+    uint16_t        frameLen;
+
+    lastTick = tick;
+    for (int i=0; i<header.pixelCount; i++, mapIdx++) {
+        curFrame[i] = gPixels->getPixel(*mapIdx);
+    }
+
+    frameLen = encodeFrame(curFrame, prevFrame, header.pixelCount, encodeBuffer + sizeof(uint16_t));
+    memcpy(encodeBuffer, &frameLen, sizeof(uint16_t));
+    bytesWritten += file.write(encodeBuffer, frameLen + sizeof(uint16_t));
+    header.frameCount++;
+
+    swap = prevFrame;
+    prevFrame = curFrame;
+    curFrame = swap;
+
+    if (--framesLeft == 0) {
+        end();
+    }
+}
+
+void FrameRecorder::end() {
+    if (file) {
+        // Patch in the final frame count
+        file.seek(0, SeekSet);
+        file.write((const uint8_t *)&header, sizeof(header));
+        file.close();
+
+        Serial.printf_P(PSTR("Recorded %u frames, %u bytes (%u bytes/frame)\n"), header.frameCount, bytesWritten,
+            header.frameCount ? bytesWritten / header.frameCount : 0);
+    }
+
+    free(curFrame);
+    free(prevFrame);
+    free(encodeBuffer);
+    curFrame = nullptr;
+    prevFrame = nullptr;
+    encodeBuffer = nullptr;
+}
+
+size_t FrameRecorder::encodeFrame(const SPixelRec *cur, const SPixelRec *prev, uint16_t count, uint8_t *output) {
+    uint8_t     *outP = output;
+    uint16_t    idx = 0;
+
+    while (idx < count) {
+        uint16_t    runLen = 1;
+
+        if (cur[idx].rgbw == prev[idx].rgbw) {
+            while (idx + runLen < count && runLen < kFRAME_OP_MAX && cur[idx + runLen].rgbw == prev[idx + runLen].rgbw) {
+                runLen++;
+            }
+            *outP++ = frame_op_skip | (runLen - 1);
+        }
+        else if (idx + 1 < count && cur[idx].rgbw == cur[idx + 1].rgbw) {
+            while (idx + runLen < count && runLen < kFRAME_OP_MAX && cur[idx + runLen].rgbw == cur[idx].rgbw) {
+                runLen++;
+            }
+            *outP++ = frame_op_run | (runLen - 1);
+            memcpy(outP, &cur[idx], sizeof(SPixelRec));
+            outP += sizeof(SPixelRec);
+        }
+        else {
+            // literal pixels until something changes to a skip or a run
+            while (idx + runLen < count && runLen < kFRAME_OP_MAX && cur[idx + runLen].rgbw != prev[idx + runLen].rgbw &&
+                (idx + runLen + 1 >= count || cur[idx + runLen].rgbw != cur[idx + runLen + 1].rgbw)) {
+                runLen++;
+            }
+            *outP++ = frame_op_copy | (runLen - 1);
+            memcpy(outP, &cur[idx], runLen * sizeof(SPixelRec));
+            outP += runLen * sizeof(SPixelRec);
+        }
+
+        idx += runLen;
+    }
+
+    return outP - output;
+}
@@ -0,0 +1,88 @@
+//
+//  FrameRecorder.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef FrameRecorder_h
+#define FrameRecorder_h
+
+#include "PixelController.h"
+#include <LittleFS.h>
+
+// Frame file format (played back by PxlFX_Playback):
+//
+// FrameHeaderRec followed by frameCount frames. Each frame is a uint16_t byte
+// length followed by ops which describe the frame relative to the previous one
+// (the first frame is relative to all black). Each op is a byte whose top two
+// bits are the kind and low six bits are count - 1 (1 - 64 pixels):
+//
+//  frame_op_skip:  count pixels are unchanged from the previous frame
+//  frame_op_copy:  count literal pixels follow (4 bytes each, GRBW)
+//  frame_op_run:   one pixel follows which is repeated count times
+//
+// Slow moving effects mostly turn into skips and solid areas into runs.
+
+#define kFRAME_MAGIC        0x52464C4B      // "KLFR"
+#define kFRAME_VERSION      1
+#define kFRAME_OP_MAX       64
+
+enum {
+    frame_op_skip = 0x00,
+    frame_op_copy = 0x40,
+    frame_op_run  = 0x80,
+};
+
+typedef struct __attribute__((__packed__)) {
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    pixelCount;
+    uint16_t    frameTicks;     // ticks per frame
+    uint16_t    frameCount;
+} FrameHeaderRec, *FrameHeaderPtr;
+
+// Captures an area from the live pixel buffer once per frame and writes it to
+// LittleFS in the format above. The request calls are for the AsyncTCP
+// handlers: the file is opened and closed from loop().
+
+class FrameRecorder {
+public:
+    FrameRecorder();
+
+    bool begin(uint16_t areaID, uint16_t frames, const char *path, uint16_t frameTicks=1);
+    void loop();
+    void end();
+
+    bool requestBegin(uint16_t areaID, uint16_t frames, const char *path, uint16_t frameTicks=1);
+    inline void requestEnd() { endRequested = true; beginRequested = false; }
+
+    inline bool isRecording() { return file; }
+    inline uint16_t recordedFrames() { return header.frameCount; }
+    inline uint32_t recordedBytes() { return bytesWritten; }
+
+    static size_t encodeFrame(const SPixelRec *cur, const SPixelRec *prev, uint16_t count, uint8_t *output);
+
+private:
+    bool            beginRequested;
+    bool            endRequested;
+    uint16_t        requestArea;
+    uint16_t        requestFrames;
+    uint16_t        requestTicks;
+    char            requestPath[kFX_PATH_LEN];      // must fit in a playback effect's spec
+
+    File            file;
+    FrameHeaderRec  header;
+    uint16_t        areaID;
+    uint16_t        framesLeft;
+    uint32_t        lastTick;
+    uint32_t        bytesWritten;
+    SPixelPtr       curFrame;
+    SPixelPtr       prevFrame;
+    uint8_t         *encodeBuffer;
+};
+
+extern FrameRecorder gFrameRecorder;
+
+#endif
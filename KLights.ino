@@ -9,6 +9,13 @@
 #include "PixelController.h"
 #include "ColorUtils.h"
 #include "NetworkMgr.h"
+#include "StateJournal.h"
+#include "SceneScheduler.h"
+#include "FrameRecorder.h"
+#include "SyncClock.h"
+#include "LoopScheduler.h"
+#include "LoadTest.h"
+#include "CommandTrace.h"
 #include "config.h"
 #include <LittleFS.h>
 
@@ -20,6 +27,7 @@ void pixelSetup() {
     PixelController::SectionRec    main[] = { { 0, 147 }, { 149, 71 } };
 
     gPixels = new PixelController(2, stripInfo);
+    gPixels->loadLayout();          // optional, before areas are defined
     gPixels->defineArea(area_main, 2, main);
     gPixels->defineArea(area_status_1, 147, 1);
     gPixels->defineArea(area_status_2, 148, 1);
@@ -30,10 +38,12 @@ void pixelSetup() {
     PixelController::SectionRec    status2[] = { { 38, 1 } };
 
     gPixels = new PixelController(77, D1);
+    gPixels->loadLayout();
     gPixels->defineArea(area_main, 2, main);
     gPixels->defineArea(area_status_1, 37, 1);
     gPixels->defineArea(area_status_2, 38, 1);
 #endif
+    gStateJournal.restore(gPixels);     // last known state, before any networking
     gPixels->setAreaColor(area_status_1, ColorUtils::red.withVal(0.10));
     gPixels->setAreaColor(area_status_2, ColorUtils::red.withVal(0.10));
     gPixels->show();
@@ -43,16 +53,25 @@ void setup() {
     Serial.begin(115200);
     Serial.println(ESP.getResetInfo());
 
-    pixelSetup();
-
     if (!LittleFS.begin()) {
         Serial.print(F("Failed to mount filesystem (LittleFS)"));
     }
-    
+
+    pixelSetup();
+    gSceneScheduler.load();
     gNetworkMgr.setup();
+
+    // Budgets in µS. Frames come first, see LoopScheduler.h
+    gLoopScheduler.addTask("network", 10000, []() { gNetworkMgr.loop(); });
+    gLoopScheduler.addTask("sync", 1000, []() { gSyncClock.loop(); });
+    gLoopScheduler.addTask("journal", 4000, []() { gStateJournal.loop(); });
+    gLoopScheduler.addTask("scenes", 1000, []() { gSceneScheduler.loop(); });
+    gLoopScheduler.addTask("recorder", 5000, []() { gFrameRecorder.loop(); });
+    gLoopScheduler.addTask("loadtest", 1000, []() { gLoadTest.loop(); });
+    gLoopScheduler.addTask("trace", 2000, []() { gCommandTrace.loop(); });
 }
 
 void loop() {
-    gNetworkMgr.loop();
+    gLoopScheduler.loop();
 }
 
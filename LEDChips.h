@@ -0,0 +1,81 @@
+//
+//  LEDChips.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef LEDChips_h
+#define LEDChips_h
+
+#include "ColorUtils.h"
+
+// Compile time description of the LED chips we can drive. Each chip is a pair
+// of bit timings and an output pixel format. The pixel buffer itself is always
+// GRBW (SPixelRec); the format says which of those bytes go out on the wire, in
+// what order, and whether white has to be folded into RGB for chips that don't
+// have a white LED. Strips pick a chip at runtime and the show routine is
+// instantiated once per chip (see espshow.cpp).
+//
+// Define SUPPORT_xxx to 0 to leave a chip's show routine out of IRAM.
+
+enum {
+    strip_sk6812_grbw = 0,
+    strip_ws2812_grb,
+};
+
+#ifndef SUPPORT_SK6812_GRBW
+#define SUPPORT_SK6812_GRBW     1
+#endif
+
+#ifndef SUPPORT_WS2812_GRB
+#define SUPPORT_WS2812_GRB      1
+#endif
+
+#ifndef kDEFAULT_STRIP_CHIP
+#define kDEFAULT_STRIP_CHIP     strip_sk6812_grbw
+#endif
+
+// Times in nS (reset in µS), converted to CPU cycles
+template <uint32_t T0H_NS, uint32_t T1H_NS, uint32_t PERIOD_NS, uint32_t RESET_US>
+struct LEDTiming {
+    static const uint32_t   t0h = (F_CPU / 1000000) * T0H_NS / 1000;
+    static const uint32_t   t1h = (F_CPU / 1000000) * T1H_NS / 1000;
+    static const uint32_t   period = (F_CPU / 1000000) * PERIOD_NS / 1000;
+    static const uint32_t   resetDur = RESET_US;
+};
+
+// Offsets are into SPixelRec: g = 0, r = 1, b = 2, w = 3
+template <uint8_t BYTES, uint8_t O0, uint8_t O1, uint8_t O2, uint8_t O3, bool FOLD_WHITE>
+struct PixelFormat {
+    static const uint8_t    bytes = BYTES;
+    static const bool       foldWhite = FOLD_WHITE;
+
+    static inline uint8_t offset(uint8_t idx) { return idx == 0 ? O0 : idx == 1 ? O1 : idx == 2 ? O2 : O3; }
+};
+
+template <class TimingT, class FormatT>
+struct LEDChip {
+    typedef TimingT Timing;
+    typedef FormatT Format;
+};
+
+// SK6812RGBW data sheet: T0H 0.3µS, T1H 0.6µS, 1.25µS per bit, reset 80µS
+typedef LEDChip<LEDTiming<300, 600, 1250, 80>, PixelFormat<4, 0, 1, 2, 3, false>>   Chip_SK6812_GRBW;
+// WS2812B (V5) data sheet: T0H 0.4µS, T1H 0.8µS, 1.25µS per bit, reset 280µS
+typedef LEDChip<LEDTiming<400, 800, 1250, 280>, PixelFormat<3, 0, 1, 2, 0, true>>   Chip_WS2812_GRB;
+
+static inline uint32_t chipResetDur(uint8_t chip) {
+    return chip == strip_ws2812_grb ? Chip_WS2812_GRB::Timing::resetDur : Chip_SK6812_GRBW::Timing::resetDur;
+}
+
+static inline uint8_t chipBytesPerPixel(uint8_t chip) {
+    return chip == strip_ws2812_grb ? Chip_WS2812_GRB::Format::bytes : Chip_SK6812_GRBW::Format::bytes;
+}
+
+// scale is 8.8 fixed point applied to every byte sent, 256 leaves pixels as is
+IRAM_ATTR void espShow(uint8_t chip, uint8_t pin, const SPixelRec *pixels, uint16_t numPixels, uint16_t scale);
+IRAM_ATTR void espClear(uint8_t chip, uint8_t pin, uint16_t numPixels);
+
+#endif
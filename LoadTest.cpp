@@ -0,0 +1,305 @@
+//
+//  LoadTest.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "LoadTest.h"
+#include "LoopScheduler.h"
+#include "config.h"
+#include <LittleFS.h>
+
+#define kLOADTEST_REPORT_LEN    768
+
+LoadTest gLoadTest;
+
+static const char *const kindNames[load_kind_count] = { "color", "effect", "toggle", "batch" };
+static const uint8_t effectTypes[] = { fx_rainbow, fx_wave, fx_cylon, fx_sparkle, fx_fire, fx_plasma };
+
+LoadTest::LoadTest() {
+    running = false;
+    stopRequested = false;
+    issuedTotal = 0;
+    areaCount = 0;
+}
+
+// mix is a list of kind[:weight] (weight defaults to 1), areaList a list of
+// area IDs. Either can be empty for colors only on the main area.
+
+bool LoadTest::begin(const char *mix, const char *areaList, float rate, float duration) {
+    if (running || !parseMix(mix) || !parseAreas(areaList)) {
+        return false;
+    }
+
+    rate = rate > 0.0 ? min(rate, (float)kLOADTEST_MAX_RATE) : kLOADTEST_DEFAULT_RATE;
+    duration = duration > 0.0 ? duration : kLOADTEST_DEFAULT_DURATION;
+
+    for (uint8_t i=0; i<areaCount; i++) {
+        gPixels->getAreaState(areaIDs[i], savedState[i]);
+    }
+    memset(issued, 0, sizeof(issued));
+    memset(&tickStats, 0, sizeof(tickStats));
+    memset(&latencyStats, 0, sizeof(latencyStats));
+    issuedTotal = 0;
+    dropped = 0;
+    timing = false;
+
+    interval = 1000000.0 / rate;
+    nextCommand = micros();
+    startTime = millis();
+    durationMS = duration * 1000.0;
+    seed = micros() | 1;
+
+    lastTick = gPixels->getTick();
+    startFrames = gLoopScheduler.getFrameStats().frames;
+    startMissed = gLoopScheduler.getFrameStats().missed;
+    heapStart = heapMin = ESP.getFreeHeap();
+    blockMin = ESP.getMaxFreeBlockSize();
+    fragMax = ESP.getHeapFragmentation();
+
+    stopRequested = false;
+    running = true;
+    Serial.printf_P(PSTR("Load test: %u areas, %u cmds/s for %us\n"), areaCount, (uint32_t)rate, durationMS / 1000);
+
+    return true;
+}
+
+bool LoadTest::parseMix(const char *mix) {
+    weightTotal = 0;
+    memset(weights, 0, sizeof(weights));
+
+    while (mix != nullptr && *mix != 0) {
+        const char  *end = mix + strcspn(mix, ":,");
+        uint8_t     kind;
+
+        for (kind=0; kind<load_kind_count; kind++) {
+            if (strlen(kindNames[kind]) == (size_t)(end - mix) && !strncmp(mix, kindNames[kind], end - mix)) {
+                break;
+            }
+        }
+        if (kind >= load_kind_count) {
+            return false;
+        }
+
+        weights[kind] = *end == ':' ? constrain(atoi(end + 1), 0, 100) : 1;
+        weightTotal += weights[kind];
+
+        mix = strchr(end, ',');
+        mix = mix != nullptr ? mix + 1 : nullptr;
+    }
+
+    if (weightTotal == 0) {
+        weights[load_color] = 1;
+        weightTotal = 1;
+    }
+
+    return true;
+}
+
+bool LoadTest::parseAreas(const char *areaList) {
+    areaCount = 0;
+
+    while (areaList != nullptr && *areaList != 0) {
+        int     areaID = atoi(areaList);
+
+        if (areaID < 0 || areaID >= kMAX_PIXEL_AREAS || gPixels->getArea(areaID)->len <= 0 || areaCount >= kMAX_PIXEL_AREAS) {
+            return false;
+        }
+        areaIDs[areaCount++] = areaID;
+
+        areaList = strchr(areaList, ',');
+        areaList = areaList != nullptr ? areaList + 1 : nullptr;
+    }
+
+    if (areaCount == 0) {
+        areaIDs[areaCount++] = area_main;
+    }
+
+    return true;
+}
+
+void LoadTest::loop() {
+    uint32_t    now = micros();
+
+    if (!running) {
+        return;
+    }
+
+    sample();
+
+    if ((int32_t)(now - nextCommand) >= 0) {
+        issueCommand(now);
+        nextCommand += interval;
+        if ((int32_t)(now - nextCommand) > (int32_t)interval * 4) {
+            nextCommand = now + interval;       // fell well behind, don't burst to catch up
+        }
+    }
+
+    if (stopRequested) {
+        finish("stopped");
+    }
+    else if (millis() - startTime >= durationMS) {
+        finish("complete");
+    }
+}
+
+void LoadTest::end() {
+    stopRequested = running;
+}
+
+void LoadTest::randomColor(PixelCommandRec &cmd) {
+    cmd.fields = kCMD_COLOR_FIELDS;
+    cmd.isOn = true;
+    cmd.color = SHSVRec(nextRandom() % 360, 1.0, 0.2 + (nextRandom() % 40) / 100.0);
+    cmd.transition = 0.25;
+}
+
+void LoadTest::issueCommand(uint32_t now) {
+    PixelCommandRec cmd;
+    uint16_t        pick = nextRandom() % weightTotal;
+    uint8_t         kind = 0;
+    bool            queued = true;
+
+    while (pick >= weights[kind]) {
+        pick -= weights[kind++];
+    }
+
+    cmd.areaID = areaIDs[nextRandom() % areaCount];
+    switch (kind) {
+        case load_color:
+            randomColor(cmd);
+            break;
+
+        case load_effect:
+            cmd.fields = cmd_effect;
+            cmd.effect.type = effectTypes[nextRandom() % sizeof(effectTypes)];
+            cmd.effect.flags = 0;
+            cmd.effect.rate = 0.5 + (nextRandom() % 150) / 100.0;
+            cmd.effect.width = 8 + nextRandom() % 32;
+            cmd.effect.duration = 0.0;
+            cmd.effect.path[0] = 0;
+            break;
+
+        case load_toggle:
+            cmd.fields = cmd_state;
+            cmd.isOn = nextRandom() & 1;
+            cmd.transition = -1.0;
+            break;
+
+        case load_batch: {
+            PixelCommandRec batch[kMAX_PIXEL_AREAS];
+
+            for (uint8_t i=0; i<areaCount; i++) {
+                batch[i].areaID = areaIDs[i];
+                randomColor(batch[i]);
+            }
+            queued = gPixels->queueCommands(batch, areaCount);
+            break;
+        }
+    }
+
+    if (kind != load_batch) {
+        queued = gPixels->queueCommand(cmd);
+    }
+
+    if (queued) {
+        issued[kind]++;
+        issuedTotal++;
+        if (!timing) {
+            queuedAt = now;
+            timing = true;
+        }
+    }
+    else {
+        dropped++;
+    }
+}
+
+// Once per tick: the tick's time, the heap and whether the command being timed
+// has been applied yet
+
+void LoadTest::sample() {
+    uint32_t    tick = gPixels->getTick();
+
+    if (tick == lastTick) {
+        return;
+    }
+    lastTick = tick;
+
+    addSample(tickStats, gPixels->getLastTickTime());
+    if (timing && (int32_t)(gPixels->getApplyTime() - queuedAt) >= 0) {
+        addSample(latencyStats, gPixels->getApplyTime() - queuedAt);
+        timing = false;
+    }
+
+    heapMin = min(heapMin, ESP.getFreeHeap());
+    blockMin = min(blockMin, (uint32_t)ESP.getMaxFreeBlockSize());
+    fragMax = max(fragMax, ESP.getHeapFragmentation());
+}
+
+void LoadTest::addSample(LoadStatRec &stat, uint32_t value) {
+    stat.min = stat.count ? min(stat.min, value) : value;
+    stat.max = max(stat.max, value);
+    stat.total += value;
+    stat.count++;
+}
+
+// The areas are restored through the command queue so they land after
+// anything the test still had pending
+
+void LoadTest::finish(const char *result) {
+    char    *report;
+    File    file;
+    size_t  reportLen;
+
+    running = false;
+    for (uint8_t i=0; i<areaCount; i++) {
+        PixelCommandRec cmd;
+
+        cmd.areaID = areaIDs[i];
+        cmd.fields = kCMD_COLOR_FIELDS;
+        cmd.isOn = savedState[i].isOn;
+        cmd.color = savedState[i].color;
+        cmd.transition = 0.0;
+        if (savedState[i].effect.type != fx_none) {
+            cmd.fields |= cmd_effect;
+            cmd.effect = savedState[i].effect;
+        }
+        gPixels->queueCommand(cmd);
+    }
+
+    if ((report = (char *)malloc(kLOADTEST_REPORT_LEN)) != nullptr) {
+        reportLen = formatReport(result, report, kLOADTEST_REPORT_LEN);
+        Serial.println(report);
+        if ((file = LittleFS.open(kLOADTEST_REPORT_PATH, "w"))) {
+            file.write((const uint8_t *)report, reportLen);
+            file.close();
+        }
+        free(report);
+    }
+}
+
+size_t LoadTest::formatReport(const char *result, char *buffer, size_t bufferLen) {
+    const SchedFrameStatsRec    &frame = gLoopScheduler.getFrameStats();
+    size_t                      len;
+
+    len = snprintf_P(buffer, bufferLen, PSTR("{ \"result\": \"%s\", \"elapsed\": %u, \"commands\": %u, \"dropped\": %u, \"mix\": { "),
+        result, millis() - startTime, issuedTotal, dropped);
+    for (uint8_t kind=0; kind<load_kind_count && len < bufferLen; kind++) {
+        len += snprintf_P(buffer + len, bufferLen - len, PSTR("%s\"%s\": %u"), kind ? ", " : "", kindNames[kind], issued[kind]);
+    }
+    if (len < bufferLen) {
+        len += snprintf_P(buffer + len, bufferLen - len,
+            PSTR(" }, \"ticks\": { \"count\": %u, \"min\": %u, \"avg\": %u, \"max\": %u, \"frames\": %u, \"missed\": %u }, "
+                 "\"latency\": { \"count\": %u, \"min\": %u, \"avg\": %u, \"max\": %u }, "
+                 "\"heap\": { \"start\": %u, \"min\": %u, \"end\": %u, \"minBlock\": %u, \"maxFrag\": %u } }"),
+            tickStats.count, tickStats.min, tickStats.count ? (uint32_t)(tickStats.total / tickStats.count) : 0, tickStats.max,
+            frame.frames - startFrames, frame.missed - startMissed,
+            latencyStats.count, latencyStats.min, latencyStats.count ? (uint32_t)(latencyStats.total / latencyStats.count) : 0, latencyStats.max,
+            heapStart, heapMin, ESP.getFreeHeap(), blockMin, fragMax);
+    }
+
+    return min(len, bufferLen - 1);
+}
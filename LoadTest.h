@@ -0,0 +1,105 @@
+//
+//  LoadTest.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef LoadTest_h
+#define LoadTest_h
+
+#include "PixelController.h"
+
+// On-device soak test for qualifying a build on the real hardware. It issues a
+// weighted mix of commands at a steady rate to a set of areas, through the same
+// queue MQTT and HTTP use, and samples as it goes:
+//
+//  tick time       min / avg / max µS of performTick, plus frames the scheduler missed
+//  heap            free heap, largest free block and worst fragmentation (%)
+//  latency         µS from a command being queued to it being applied at a tick
+//
+// When the duration is up (or it's ended early) the areas are put back the way
+// they were and a JSON report is written to kLOADTEST_REPORT_PATH and Serial.
+//
+// /$loadtest?mix=color:3,effect:1,toggle:1,batch:1&rate=10&areas=0,3&duration=600
+
+#define kLOADTEST_REPORT_PATH       "/loadtest.json"
+#define kLOADTEST_DEFAULT_RATE      5.0         // commands per second
+#define kLOADTEST_MAX_RATE          100.0
+#define kLOADTEST_DEFAULT_DURATION  60.0        // seconds
+
+enum {
+    load_color = 0,     // random hue and brightness with a short fade
+    load_effect,        // random effect and parameters
+    load_toggle,        // on or off
+    load_batch,         // color to every test area in the same tick
+    load_kind_count
+};
+
+typedef struct {
+    uint32_t    count;
+    uint32_t    min;
+    uint32_t    max;
+    uint64_t    total;
+} LoadStatRec, *LoadStatPtr;
+
+class LoadTest {
+public:
+    LoadTest();
+
+    bool begin(const char *mix, const char *areaList, float rate, float duration);
+    void loop();
+    void end();         // finishes from the next loop()
+
+    inline bool isRunning() { return running; }
+    inline uint32_t issuedCount() { return issuedTotal; }
+    inline uint32_t elapsed() { return running ? millis() - startTime : 0; }
+
+    static void addSample(LoadStatRec &stat, uint32_t value);
+
+private:
+    bool parseMix(const char *mix);
+    bool parseAreas(const char *areaList);
+    void issueCommand(uint32_t now);
+    void randomColor(PixelCommandRec &cmd);
+    void sample();
+    void finish(const char *result);
+    size_t formatReport(const char *result, char *buffer, size_t bufferLen);
+
+    inline uint32_t nextRandom() { seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; return seed; }     // xorshift32
+
+    bool                running;
+    bool                stopRequested;
+    uint8_t             weights[load_kind_count];
+    uint16_t            weightTotal;
+    uint32_t            issued[load_kind_count];
+    uint32_t            issuedTotal;
+    uint32_t            dropped;
+
+    uint16_t            areaIDs[kMAX_PIXEL_AREAS];
+    uint8_t             areaCount;
+    PixelAreaStateRec   savedState[kMAX_PIXEL_AREAS];
+
+    uint32_t            interval;       // µS between commands
+    uint32_t            nextCommand;
+    uint32_t            startTime;      // mS
+    uint32_t            durationMS;
+    uint32_t            seed;
+
+    uint32_t            lastTick;
+    uint32_t            queuedAt;       // µS, command being timed
+    bool                timing;
+    LoadStatRec         tickStats;
+    LoadStatRec         latencyStats;
+    uint32_t            startFrames;
+    uint32_t            startMissed;
+    uint32_t            heapStart;
+    uint32_t            heapMin;
+    uint32_t            blockMin;
+    uint8_t             fragMax;
+};
+
+extern LoadTest gLoadTest;
+
+#endif
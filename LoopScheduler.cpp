@@ -0,0 +1,141 @@
+//
+//  LoopScheduler.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "LoopScheduler.h"
+
+LoopScheduler gLoopScheduler;
+
+LoopScheduler::LoopScheduler() {
+    frameFunc = nullptr;
+    framePeriod = 0;
+    nextFrame = 0;
+    memset(&frameStats, 0, sizeof(frameStats));
+
+    taskCount = 0;
+    nextTask = 0;
+    curTask = nullptr;
+    sliceEnd = 0;
+}
+
+void LoopScheduler::setFrame(uint32_t period, SchedFunc func) {
+    framePeriod = period;
+    frameFunc = func;
+    nextFrame = micros() + period;
+}
+
+bool LoopScheduler::addTask(const char *name, uint32_t budget, SchedFunc func) {
+    SchedTaskPtr    task = &tasks[taskCount];
+
+    if (taskCount >= kSCHED_MAX_TASKS) {
+        return false;
+    }
+
+    task->name = name;
+    task->func = func;
+    task->budget = budget;
+    task->runs = task->avgTime = task->maxTime = task->overruns = task->lateFrames = 0;
+    taskCount++;
+
+    return true;
+}
+
+void LoopScheduler::loop() {
+    uint32_t    now = micros();
+    bool        frameRan = false;
+    bool        skipped = false;
+    uint8_t     firstIdx;
+
+    if (frameDue(now)) {
+        runFrame(now);
+        frameRan = true;
+    }
+
+    // Tasks that don't fit before the next frame are skipped and the first of
+    // them leads off after it. That's also the most time it will ever get so
+    // a task whose budget exceeds the gap between frames still runs then.
+    firstIdx = nextTask;
+    for (uint8_t tCount=0; tCount<taskCount; tCount++) {
+        uint8_t         tIdx = (firstIdx + tCount) % taskCount;
+        SchedTaskPtr    task = &tasks[tIdx];
+        int32_t         remaining;
+
+        now = micros();
+        remaining = (int32_t)(nextFrame - now) - kSCHED_GUARD_US;
+
+        if (frameFunc && remaining < (int32_t)task->budget && !(frameRan && tCount == 0)) {
+            if (!skipped) {
+                nextTask = tIdx;
+                skipped = true;
+            }
+            continue;
+        }
+
+        runTask(task, now);
+    }
+
+    if (!skipped && taskCount) {
+        nextTask = (firstIdx + 1) % taskCount;
+    }
+}
+
+// For long jobs: true once the current slice is used up or a frame is close
+
+bool LoopScheduler::shouldYield() {
+    uint32_t    now = micros();
+
+    if (curTask == nullptr) {
+        return false;
+    }
+
+    return (int32_t)(now - sliceEnd) >= 0 || (frameFunc && (int32_t)(nextFrame - now) < kSCHED_GUARD_US);
+}
+
+void LoopScheduler::runFrame(uint32_t now) {
+    uint32_t    late = now - nextFrame;
+    uint32_t    elapsed;
+
+    if (late >= framePeriod) {
+        uint32_t    skipped = late / framePeriod;
+
+        frameStats.missed += skipped;
+        nextFrame += skipped * framePeriod;
+        late -= skipped * framePeriod;
+    }
+    frameStats.maxLate = max(frameStats.maxLate, late);
+
+    frameFunc();
+
+    elapsed = micros() - now;
+    frameStats.frames++;
+    frameStats.avgTime = (frameStats.avgTime / 8) * 7 + elapsed / 8;
+    frameStats.maxTime = max(frameStats.maxTime, elapsed);
+
+    nextFrame += framePeriod;
+}
+
+void LoopScheduler::runTask(SchedTaskPtr task, uint32_t now) {
+    uint32_t    elapsed;
+
+    curTask = task;
+    sliceEnd = now + task->budget;
+
+    task->func();
+
+    curTask = nullptr;
+    elapsed = micros() - now;
+
+    task->runs++;
+    task->avgTime = (task->avgTime / 8) * 7 + elapsed / 8;
+    task->maxTime = max(task->maxTime, elapsed);
+    if (elapsed > task->budget) {
+        task->overruns++;
+    }
+    if (frameDue(micros())) {
+        task->lateFrames++;
+    }
+}
@@ -0,0 +1,86 @@
+//
+//  LoopScheduler.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef LoopScheduler_h
+#define LoopScheduler_h
+
+#include <Arduino.h>
+#include <functional>
+
+// Cooperative scheduler run from loop(). It owns the frame deadline: the frame
+// (PixelController::performTick) runs as soon as it is due and the remaining
+// time until the next one is handed out to the other tasks in round robin
+// order, each getting a slice of its own budget. A task that wouldn't fit
+// before the next frame waits until after it. Long running jobs call
+// shouldYield() and pick up where they left off on their next slice.
+//
+// Per task stats show who runs over budget and who pushes frames late.
+//
+// Note: HTTP requests are serviced from the AsyncTCP callbacks, outside of
+// loop(), so they aren't scheduled here.
+
+#define kSCHED_MAX_TASKS        8
+#define kSCHED_GUARD_US         500     // don't start slices this close to a frame
+
+typedef std::function<void()> SchedFunc;
+
+typedef struct {
+    const char  *name;
+    SchedFunc   func;
+    uint32_t    budget;         // µS
+    uint32_t    runs;
+    uint32_t    avgTime;        // µS, running average
+    uint32_t    maxTime;        // µS
+    uint32_t    overruns;       // slices longer than budget
+    uint32_t    lateFrames;     // slices that ran past the frame deadline
+} SchedTaskRec, *SchedTaskPtr;
+
+typedef struct {
+    uint32_t    frames;
+    uint32_t    missed;         // deadlines skipped entirely
+    uint32_t    avgTime;        // µS, running average
+    uint32_t    maxTime;        // µS
+    uint32_t    maxLate;        // µS, worst start past deadline
+} SchedFrameStatsRec, *SchedFrameStatsPtr;
+
+class LoopScheduler {
+public:
+    LoopScheduler();
+
+    void setFrame(uint32_t period, SchedFunc func);
+    bool addTask(const char *name, uint32_t budget, SchedFunc func);
+
+    void loop();
+    bool shouldYield();
+
+    inline uint8_t getTaskCount() { return taskCount; }
+    inline const SchedTaskRec &getTask(uint8_t taskIdx) { return tasks[taskIdx]; }
+    inline const SchedFrameStatsRec &getFrameStats() { return frameStats; }
+    inline uint32_t frameRemaining() { int32_t remaining = nextFrame - micros(); return frameFunc && remaining > 0 ? remaining : 0; }
+
+private:
+    inline bool frameDue(uint32_t now) { return frameFunc && (int32_t)(now - nextFrame) >= 0; }
+
+    void runFrame(uint32_t now);
+    void runTask(SchedTaskPtr task, uint32_t now);
+
+    SchedFunc           frameFunc;
+    uint32_t            framePeriod;    // µS
+    uint32_t            nextFrame;
+    SchedFrameStatsRec  frameStats;
+
+    SchedTaskRec        tasks[kSCHED_MAX_TASKS];
+    uint8_t             taskCount;
+    uint8_t             nextTask;
+    SchedTaskPtr        curTask;
+    uint32_t            sliceEnd;
+};
+
+extern LoopScheduler gLoopScheduler;
+
+#endif
@@ -8,135 +8,268 @@
 
 #include "NetworkMgr.h"
 #include "PixelController.h"
+#include "StateJournal.h"
+#include "SceneScheduler.h"
+#include "CommandTrace.h"
 #include "config.h"
 
 #include <ArduinoJson.h>
 
 #define kMQTT_NODE(n)           kMQTT_ENDPOINT n
+#define kMQTT_NODE_LEN(n)       (sizeof(kMQTT_NODE(n)) - 1)
 #define kMQTT_RESTORE_TIMEOUT   2000
+#define kMQTT_CONNECT_TIMEOUT   5000    // non-blocking, just how long to wait for CONNACK
+#define kMQTT_BACKOFF_MIN       1000
+#define kMQTT_BACKOFF_MAX       60000
+#define kWIFI_BACKOFF_MIN       10000
+#define kWIFI_BACKOFF_MAX       120000
+#define kTIME_TIMEOUT           5000
 
 #define kTIMEZONE               "CST6CDT,M3.2.0/2:00:00,M11.1.0/2:00:00" 
-#define kEPOCH_01012022         1640995200
 
 NetworkMgr::NetworkMgr() {
-    mqttClient.setClient(wifiClient);
-
+    netState = net_wifi_wait;
+    stateTime = 0;
+    serverStarted = false;
     awaitRestore = true;
+    mqttDropped = false;
+    memset(&heapStats, 0, sizeof(heapStats));
 }
 
+// Network bring-up is a state machine stepped from loop() so the pixel ticker,
+// status LEDs and (once WiFi is up) the web server keep running while we wait
+// on WiFi, NTP or the broker. Failed attempts back off exponentially.
+//
+// MQTT runs on AsyncMqttClient (over ESPAsyncTCP) so connecting never blocks:
+// connect() only starts the TCP handshake and the state machine polls for the
+// CONNACK or gives up after kMQTT_CONNECT_TIMEOUT. Messages arrive in the
+// AsyncTCP callbacks, like HTTP requests, so the handlers only queue commands.
+
 void NetworkMgr::setup() {
     setupWifi();
-    setupTime();
     setupMQTT();
-
-    webServer.setup();
 }
 
 void NetworkMgr::setupWifi() {
-    Serial.print(String(F("Connecting to ")) + kSSID);
+    Serial.print(F("Connecting to ")); Serial.println(kSSID);
 
     WiFi.mode(WIFI_STA);
     WiFi.begin(kSSID, kWIFI_PASS);
 
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-    }
-
-    Serial.print(F("\nWiFi connected @ : ")); Serial.println(WiFi.localIP());
-    gPixels->setAreaColor(area_status_1, ColorUtils::green.withVal(0.10));
-    gPixels->setAreaColor(area_status_2, ColorUtils::blue.withVal(0.10));
-    gPixels->show();
+    wifiBackoff.reset(kWIFI_BACKOFF_MIN);
+    wifiBackoff.fail(millis(), kWIFI_BACKOFF_MAX);
+    enterState(net_wifi_wait);
 }
 
 void NetworkMgr::setupTime() {
-    time_t  now;
-    int     attempt = 0;
-
     configTime(kTIMEZONE, "time.nist.gov", "pool.ntp.org");
-
-    do {
-        delay(250);
-        attempt++;
-        now = time(NULL);
-    } while (now < kEPOCH_01012022 && attempt < 20);
-    
-    if (attempt >= 20) {
-        Serial.println(F("Failed to set current time"));
-    }
-    else {
-        Serial.print(F("Time: ") + String(ctime(&now)));
-    }
+    enterState(net_time_wait);
 }
 
 void NetworkMgr::setupMQTT() {
     mqttClient.setServer(kMQTT_SERVER, 1883);
-    mqttClient.setCallback([this](char *c_topic, uint8_t *rawPayload, unsigned int length) {
-        this->mqttRestore(c_topic, rawPayload, length);
+    mqttClient.setClientId(kMQTT_CLIENT);
+    mqttClient.setCredentials(kMQTT_USER, kMQTT_PASS);
+    mqttClient.setWill(kMQTT_NODE("/avail"), 2, false, "offline");
+
+    mqttClient.onDisconnect([this](AsyncMqttClientDisconnectReason reason) {
+        this->mqttDropped = true;
+    });
+    mqttClient.onMessage([this](char *c_topic, char *rawPayload, AsyncMqttClientMessageProperties properties, size_t length, size_t index, size_t total) {
+        this->mqttMessage(c_topic, rawPayload, length, index, total);
     });
+    mqttBackoff.reset(kMQTT_BACKOFF_MIN);
 }
 
-void NetworkMgr::loop() {
-    StreamString    jsonStr;
+void NetworkMgr::enterState(NetState state) {
+    netState = state;
+    stateTime = millis();
+}
 
-    loopMQTT();
-    webServer.loop();
+void NetworkMgr::stepNetwork() {
+    uint32_t    now = millis();
+    bool        wifiUp = WiFi.status() == WL_CONNECTED;
 
-    if (gPixels->getUpdatedState(area_main, jsonStr)) {
-        mqttClient.publish(kMQTT_ENDPOINT, jsonStr.c_str(), true);
-        // PubSubClient::beginPublish / endPublish appears not to work as expected
+    if (!wifiUp && netState != net_wifi_wait) {
+        Serial.println(F("WiFi connection lost"));
+        mqttClient.disconnect(true);
+        gPixels->setAreaColor(area_status_1, ColorUtils::red.withVal(0.10));
+        gPixels->setAreaColor(area_status_2, ColorUtils::red.withVal(0.10));
+
+        wifiBackoff.reset(kWIFI_BACKOFF_MIN);
+        wifiBackoff.fail(now, kWIFI_BACKOFF_MAX);
+        enterState(net_wifi_wait);
+    }
+
+    switch (netState) {
+        case net_wifi_wait:
+            if (wifiUp) {
+                Serial.print(F("WiFi connected @ : ")); Serial.println(WiFi.localIP());
+                gPixels->setAreaColor(area_status_1, ColorUtils::green.withVal(0.10));
+                gPixels->setAreaColor(area_status_2, ColorUtils::blue.withVal(0.10));
+
+                if (!serverStarted) {
+                    webServer.setup();
+                    serverStarted = true;
+                }
+                setupTime();
+            }
+            else if (wifiBackoff.due(now)) {
+                // The SDK retries on its own but kick it in case it has given up
+                Serial.println(F("WiFi not connected, retrying"));
+                WiFi.disconnect();
+                WiFi.begin(kSSID, kWIFI_PASS);
+                wifiBackoff.fail(now, kWIFI_BACKOFF_MAX);
+            }
+            break;
+
+        case net_time_wait: {
+            time_t  curTime = time(NULL);
+
+            if (curTime >= kEPOCH_01012022) {
+                Serial.print(F("Time: ")); Serial.print(ctime(&curTime));
+                enterState(net_mqtt_connect);
+            }
+            else if (now - stateTime > kTIME_TIMEOUT) {
+                // SNTP will keep trying in the background
+                Serial.println(F("Failed to set current time"));
+                enterState(net_mqtt_connect);
+            }
+            break;
+        }
+
+        case net_mqtt_connect:
+            if (mqttBackoff.due(now)) {
+                Serial.println(F("Attempting MQTT connection..."));
+                mqttDropped = false;
+                mqttClient.connect();
+                enterState(net_mqtt_wait);
+            }
+            break;
+
+        case net_mqtt_wait:
+            if (mqttClient.connected()) {
+                mqttConnect();
+            }
+            else if (mqttDropped || now - stateTime > kMQTT_CONNECT_TIMEOUT) {
+                mqttClient.disconnect(true);
+                mqttBackoff.fail(now, kMQTT_BACKOFF_MAX);
+                Serial.printf_P(PSTR("MQTT connect failed, try again in %u ms\n"), mqttBackoff.interval);
+                enterState(net_mqtt_connect);
+            }
+            break;
+
+        case net_online:
+            if (!mqttClient.connected()) {
+                Serial.println(F("MQTT connection lost"));
+                mqttBackoff.reset(kMQTT_BACKOFF_MIN);
+                enterState(net_mqtt_connect);
+            }
+            break;
     }
 }
 
-void NetworkMgr::loopMQTT() {
-    if (!mqttClient.connected()) {
-        mqttReconnect();
+void NetworkMgr::loop() {
+    size_t  stateLen;
+
+    stepNetwork();
+
+    if (netState == net_online) {
+        loopMQTT();
     }
-    else if (awaitRestore && millis() - mqttConnectTime > kMQTT_RESTORE_TIMEOUT) {
-        Serial.println(F("Failed to restore state. Reset lights."));
 
+    if (serverStarted) {
+        webServer.loop();
+    }
+
+    // State is serialized into a reusable buffer and published with an
+    // explicit length, QoS 0 so it goes straight into the TCP send buffer.
+    if (netState == net_online) {
+        uint32_t    freeHeap = ESP.getFreeHeap();
+
+        if ((stateLen = gPixels->getUpdatedState(area_main, stateBuffer, sizeof(stateBuffer))) > 0) {
+            heapStats.states++;
+            checkHeap(freeHeap, F("state"));
+            mqttClient.publish(kMQTT_ENDPOINT, 0, true, stateBuffer, stateLen);
+        }
+    }
+}
+
+void NetworkMgr::loopMQTT() {
+    if (awaitRestore && millis() - mqttConnectTime > kMQTT_RESTORE_TIMEOUT) {
         awaitRestore = false;
-        gPixels->resetArea(area_main);   // Off, 50% white
+
+        // The retained state only reconciles what the journal already restored
+        if (!gStateJournal.didRestore(area_main)) {
+            Serial.println(F("Failed to restore state. Reset lights."));
+            gPixels->resetArea(area_main);   // Off, 50% white
+        }
         beginMQTTMonitor();
     }
-
-    mqttClient.loop();
 }
 
-void NetworkMgr::mqttReconnect() {
-    while (!mqttClient.connected()) {
-        Serial.print(F("Attempting MQTT connection... "));
+// Connected (CONNACK received)
 
-        if (mqttClient.connect(kMQTT_CLIENT, kMQTT_USER, kMQTT_PASS, kMQTT_NODE("/avail"), 2, false, "offline")) {
-            Serial.print(F(" connected to: ")); Serial.println(kMQTT_ENDPOINT);
-            mqttConnectTime = millis();
-            mqttClient.subscribe(kMQTT_ENDPOINT);
-        } else {
-            Serial.println(String(F("failed, rc=") + String(mqttClient.state()) + F(" try again in 5 seconds")));
+void NetworkMgr::mqttConnect() {
+    Serial.print(F("MQTT connected to: ")); Serial.println(kMQTT_ENDPOINT);
+    mqttConnectTime = millis();
+    mqttBackoff.reset(kMQTT_BACKOFF_MIN);
 
-            delay(5000);
-        }
+    if (awaitRestore) {
+        mqttClient.subscribe(kMQTT_ENDPOINT, 0);
     }
+    else {
+        beginMQTTMonitor();     // reconnect: resume monitoring
+    }
+    enterState(net_online);
 }
 
 void NetworkMgr::beginMQTTMonitor() {
-    StreamString    jsonStr;
-
     mqttClient.unsubscribe(kMQTT_ENDPOINT);
-    mqttClient.setCallback([this](char *c_topic, uint8_t *rawPayload, unsigned int length) {
-        this->mqttMonitor(c_topic, rawPayload, length);
-    });
+    mqttClient.publish(kMQTT_NODE("/avail"), 0, true, "online");
+    mqttClient.subscribe(kMQTT_NODE("/#"), 0);
+}
+
+// Our payloads fit in a single TCP segment so they always arrive whole. Anything
+// split across callbacks is too big to be a command and is dropped.
+
+void NetworkMgr::mqttMessage(char *c_topic, char *rawPayload, size_t length, size_t index, size_t total) {
+    if (index != 0 || length != total) {
+        Serial.print(F("MQTT message too large, ignored: ")); Serial.println(c_topic);
+        return;
+    }
 
-    mqttClient.publish(kMQTT_NODE("/avail"), "online", true);
-    mqttClient.subscribe(kMQTT_NODE("/#"));
+    if (awaitRestore) {
+        gCommandTrace.recordMQTT(c_topic, (byte *)rawPayload, length, true);
+        mqttRestore(c_topic, (byte *)rawPayload, length);
+    }
+    else {
+        uint32_t    freeHeap = ESP.getFreeHeap();
+
+        gCommandTrace.recordMQTT(c_topic, (byte *)rawPayload, length, false);     // before it's parsed in place
+        mqttMonitor(c_topic, (byte *)rawPayload, length);
+        heapStats.messages++;
+        checkHeap(freeHeap, F("monitor"));
+    }
 }
 
-void NetworkMgr::mqttRestore(char* c_topic, byte* rawPayload, unsigned int length) {
-    String              topic(c_topic);
+// Nothing else runs between the two readings (loop() doesn't yield in the
+// middle and the AsyncTCP callbacks don't preempt each other) so any drop
+// belongs to the path being checked.
+
+void NetworkMgr::checkHeap(uint32_t freeBefore, const __FlashStringHelper *path) {
+    uint32_t    freeAfter = ESP.getFreeHeap();
+
+    if (freeAfter < freeBefore) {
+        heapStats.heapLost++;
+        Serial.print(F("MQTT ")); Serial.print(path); Serial.printf_P(PSTR(" path lost %u bytes of heap\n"), freeBefore - freeAfter);
+    }
+}
 
-    if (topic.equals(kMQTT_ENDPOINT)) {
+void NetworkMgr::mqttRestore(char* c_topic, byte* rawPayload, unsigned int length) {
+    if (!strcmp(c_topic, kMQTT_ENDPOINT)) {
         StaticJsonDocument<256> jsonDoc;
-        DeserializationError    error = deserializeJson(jsonDoc, rawPayload, length);
+        DeserializationError    error = deserializeJson(jsonDoc, (char *)rawPayload, length);     // in place
 
         Serial.println(F("LED state restore..."));
         if (error) {
@@ -154,16 +287,18 @@ void NetworkMgr::mqttRestore(char* c_topic, byte* rawPayload, unsigned int lengt
 }
 
 void NetworkMgr::mqttMonitor(char* c_topic, byte* rawPayload, unsigned int length) {
-    String              topic(c_topic);
-    String              lightsPath(kMQTT_NODE("/"));
+    // Topic dispatch is done directly on the raw topic and the payload is parsed
+    // in place (ArduinoJson's zero-copy mode for char *) so no String or copy is
+    // created per message. The payload buffer belongs to AsyncMqttClient and is
+    // only valid for the duration of this callback, which is fine since commands
+    // copy out what they need.
 
-    if (topic.startsWith(lightsPath)) {
-        StaticJsonDocument<256> jsonDoc;
+    if (!strncmp(c_topic, kMQTT_NODE("/"), kMQTT_NODE_LEN("/"))) {
+        const char  *node = c_topic + kMQTT_NODE_LEN("/");
 
-        topic.remove(0, lightsPath.length());
-
-        if (topic == "set") {
-            DeserializationError error = deserializeJson(jsonDoc, rawPayload, length);
+        if (!strcmp(node, "set")) {
+            StaticJsonDocument<256> jsonDoc;
+            DeserializationError    error = deserializeJson(jsonDoc, (char *)rawPayload, length);
 
             if (error) {
                 Serial.print(F("deserializeJson() failed: "));
@@ -173,5 +308,20 @@ void NetworkMgr::mqttMonitor(char* c_topic, byte* rawPayload, unsigned int lengt
                 gPixels->handleMQTTCommand(jsonDoc);
             }
         }
+        else if (!strcmp(node, "playlist")) {
+            char    name[kPLAYLIST_NAME_LEN];
+
+            // plain text payload: a playlist name or "stop"
+            length = min(length, (unsigned int)sizeof(name) - 1);
+            memcpy(name, rawPayload, length);
+            name[length] = 0;
+
+            if (!strcmp(name, "stop")) {
+                gSceneScheduler.stop();
+            }
+            else if (!gSceneScheduler.start(name)) {
+                Serial.print(F("Unknown playlist: ")); Serial.println(name);
+            }
+        }
     }
 }
@@ -10,35 +10,87 @@
 #define NetworkMgr_h
 
 #include <Arduino.h>
-#include <PubSubClient.h>
 #include <ESP8266WiFi.h>
+#include <AsyncMqttClient.h>
 #include "ServerMgr.h"
 
+#define kSTATE_BUFFER_LEN       256
+
+// The monitor and state publish paths are meant to be allocation free. Each pass
+// compares the free heap before and after so a regression shows up in /$sysinfo
+// and on Serial rather than as a slow leak.
+typedef struct {
+    uint32_t    messages;       // handled by mqttMonitor
+    uint32_t    states;         // serialized for publishing
+    uint32_t    heapLost;       // passes of either that left the free heap smaller
+} MQTTHeapStatsRec, *MQTTHeapStatsPtr;
+
 class NetworkMgr {
 public:
+    typedef enum {
+        net_wifi_wait = 0,
+        net_time_wait,
+        net_mqtt_connect,
+        net_mqtt_wait,      // connect issued, waiting on CONNACK
+        net_online,
+    } NetState;
+
+    typedef struct {
+        uint32_t        interval;
+        uint32_t        lastTry;
+        bool            waiting;
+
+        void reset(uint32_t minInterval) { interval = minInterval; waiting = false; }
+        bool due(uint32_t now) { return !waiting || (now - lastTry) >= interval; }
+        void fail(uint32_t now, uint32_t maxInterval) {
+            if (waiting) {
+                interval = min(interval * 2, maxInterval);
+            }
+            lastTry = now;
+            waiting = true;
+        }
+    } BackoffRec;
+
     NetworkMgr();
     
     void setup();
     void loop();
 
+    void mqttMonitor(char* c_topic, byte* rawPayload, unsigned int length);     // public for CommandTrace replay
+
+    inline const MQTTHeapStatsRec &getHeapStats() { return heapStats; }
+
 protected:
     void setupWifi();
     void setupTime();
     void setupMQTT();
-    
+
+    void enterState(NetState state);
+    void stepNetwork();
     void loopMQTT();
 
-    void mqttReconnect();
+    void mqttConnect();
+    void mqttMessage(char *c_topic, char *rawPayload, size_t length, size_t index, size_t total);
+
+    void checkHeap(uint32_t freeBefore, const __FlashStringHelper *path);
 
     void beginMQTTMonitor();
     void mqttRestore(char* c_topic, byte* rawPayload, unsigned int length);
-    void mqttMonitor(char* c_topic, byte* rawPayload, unsigned int length);
 
-    WiFiClient              wifiClient;
-    PubSubClient            mqttClient;
+    AsyncMqttClient         mqttClient;
     ServerMgr               webServer;
+    NetState                netState;
+    uint32_t                stateTime;
+    BackoffRec              wifiBackoff;
+    BackoffRec              mqttBackoff;
+    bool                    serverStarted;
     uint32_t                mqttConnectTime;
-    bool                    awaitRestore;
+    volatile bool           awaitRestore;       // also cleared from the AsyncTCP callbacks
+    volatile bool           mqttDropped;        // set from onDisconnect
+    char                    stateBuffer[kSTATE_BUFFER_LEN];
+    MQTTHeapStatsRec        heapStats;
 };
 
+extern NetworkMgr gNetworkMgr;
+
 #endif
@@ -0,0 +1,104 @@
+//
+//  Noise.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "Noise.h"
+
+// Ken Perlin's reference permutation
+static const uint8_t PROGMEM perm_table[256] = {
+    151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225,
+    140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23, 190, 6, 148,
+    247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32,
+    57, 177, 33, 88, 237, 149, 56, 87, 174, 20, 125, 136, 171, 168, 68, 175,
+    74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122,
+    60, 211, 133, 230, 220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54,
+    65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+    200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64,
+    52, 217, 226, 250, 124, 123, 5, 202, 38, 147, 118, 126, 255, 82, 85, 212,
+    207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213,
+    119, 248, 152, 2, 44, 154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9,
+    129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+    218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241,
+    81, 51, 145, 235, 249, 14, 239, 107, 49, 192, 214, 31, 181, 199, 106, 157,
+    184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93,
+    222, 114, 67, 29, 24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180
+};
+
+// 1D gradients, in 1/4ths
+static const int8_t PROGMEM grad1_table[8] = { -4, -3, -2, -1, 1, 2, 3, 4 };
+
+// 2D gradients: the four diagonals and four axes
+static const int8_t PROGMEM grad2_table[8][2] = {
+    { 1, 1 }, { -1, 1 }, { 1, -1 }, { -1, -1 },
+    { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 },
+};
+
+#define kNOISE2_SCALE   160     // spreads 2D results over 0 - 255 with little clipping
+
+#define PERM(i)     pgm_read_byte(&perm_table[(uint8_t)(i)])
+
+// 3t^2 - 2t^3 on 0 - 255
+static inline int32_t fade(int32_t t) {
+    return (((t * t) >> 8) * (768 - 2 * t)) >> 8;
+}
+
+static inline int32_t lerp(int32_t a, int32_t b, int32_t t) {
+    return a + (((b - a) * t) >> 8);
+}
+
+static inline int32_t grad1(uint8_t hash, int32_t dx) {
+    return ((int8_t)pgm_read_byte(&grad1_table[hash & 7]) * dx) >> 2;
+}
+
+static inline int32_t grad2(uint8_t hash, int32_t dx, int32_t dy) {
+    const int8_t    *grad = grad2_table[hash & 7];
+
+    return (int8_t)pgm_read_byte(&grad[0]) * dx + (int8_t)pgm_read_byte(&grad[1]) * dy;
+}
+
+static inline uint8_t clamp8(int32_t value) {
+    return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+uint8_t Noise::noise1(uint16_t x) {
+    uint8_t     xi = x >> 8;
+    int32_t     xf = x & 0xFF;
+    int32_t     n0 = grad1(PERM(xi), xf);
+    int32_t     n1 = grad1(PERM(xi + 1), xf - 256);
+
+    return clamp8(128 + lerp(n0, n1, fade(xf)));
+}
+
+uint8_t Noise::noise2(uint16_t x, uint16_t y) {
+    uint8_t     xi = x >> 8;
+    uint8_t     yi = y >> 8;
+    int32_t     xf = x & 0xFF;
+    int32_t     yf = y & 0xFF;
+    uint8_t     a = PERM(xi) + yi;
+    uint8_t     b = PERM(xi + 1) + yi;
+    int32_t     u = fade(xf);
+    int32_t     top = lerp(grad2(PERM(a), xf, yf), grad2(PERM(b), xf - 256, yf), u);
+    int32_t     bottom = lerp(grad2(PERM(a + 1), xf, yf - 256), grad2(PERM(b + 1), xf - 256, yf - 256), u);
+
+    return clamp8(128 + ((lerp(top, bottom, fade(yf)) * kNOISE2_SCALE) >> 8));
+}
+
+uint8_t Noise::fractal2(uint16_t x, uint16_t y, uint8_t octaves) {
+    int32_t     sum = 0;
+    int32_t     weight = 128;
+    int32_t     total = 0;
+
+    for (uint8_t i=0; i<octaves; i++) {
+        sum += ((int32_t)noise2(x, y) - 128) * weight;
+        total += weight;
+        weight >>= 1;
+        x <<= 1;
+        y <<= 1;
+    }
+
+    return total > 0 ? clamp8(128 + sum / total) : 128;
+}
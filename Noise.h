@@ -0,0 +1,27 @@
+//
+//  Noise.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef Noise_h
+#define Noise_h
+
+#include <Arduino.h>
+
+// Integer gradient (Perlin) noise for effects that want something organic
+// without floats. Coordinates are 8.8 fixed point: the high byte picks the
+// lattice cell and the low byte is the position within it, so one unit of
+// 256 spans a single cell and the pattern repeats every 256 cells (a uint16_t
+// wrapping around is seamless). Results are 0 - 255, centered on 128.
+
+class Noise {
+public:
+    static uint8_t noise1(uint16_t x);
+    static uint8_t noise2(uint16_t x, uint16_t y);
+    static uint8_t fractal2(uint16_t x, uint16_t y, uint8_t octaves);   // each octave double the frequency, half the weight
+};
+
+#endif
@@ -0,0 +1,106 @@
+//
+//  PixelCommand.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PixelCommand.h"
+
+PixelCommandQueue::PixelCommandQueue() {
+    head = 0;
+    used = 0;
+}
+
+bool PixelCommandQueue::push(const PixelCommandRec &cmd) {
+    // Look for a pending command for the same area and fold this one into it
+    for (uint16_t i=0; i<used; i++) {
+        PixelCommandRec &pending = cmds[(head + i) % kCMD_QUEUE_LEN];
+
+        if (pending.areaID == cmd.areaID) {
+            merge(pending, cmd);
+            return true;
+        }
+    }
+
+    if (used >= kCMD_QUEUE_LEN) {
+        return false;
+    }
+
+    PixelCommandRec &added = cmds[(head + used) % kCMD_QUEUE_LEN];
+
+    added = cmd;
+    added.effectLast = (cmd.fields & cmd_effect) != 0;
+    used++;
+
+    return true;
+}
+
+// All or nothing, so a batch is never split across ticks by a full queue
+
+bool PixelCommandQueue::pushAll(const PixelCommandRec *batch, uint16_t count) {
+    uint16_t    needed = 0;
+
+    for (uint16_t i=0; i<count; i++) {
+        bool    merges = false;
+
+        for (uint16_t j=0; j<used && !merges; j++) {
+            merges = cmds[(head + j) % kCMD_QUEUE_LEN].areaID == batch[i].areaID;
+        }
+        for (uint16_t j=0; j<i && !merges; j++) {
+            merges = batch[j].areaID == batch[i].areaID;
+        }
+        if (!merges) {
+            needed++;
+        }
+    }
+
+    if (used + needed > kCMD_QUEUE_LEN) {
+        return false;
+    }
+
+    for (uint16_t i=0; i<count; i++) {
+        push(batch[i]);
+    }
+
+    return true;
+}
+
+bool PixelCommandQueue::pop(PixelCommandRec &cmd) {
+    if (used == 0) {
+        return false;
+    }
+
+    cmd = cmds[head];
+    head = (head + 1) % kCMD_QUEUE_LEN;
+    used--;
+
+    return true;
+}
+
+void PixelCommandQueue::merge(PixelCommandRec &dst, const PixelCommandRec &src) {
+    if (src.fields & cmd_state) {
+        dst.isOn = src.isOn;
+    }
+    if (src.fields & kCMD_COLOR_FIELDS) {
+        dst.transition = src.transition;
+    }
+    if (src.fields & cmd_color) {
+        dst.color.hue = src.color.hue;
+        dst.color.sat = src.color.sat;
+    }
+    if (src.fields & cmd_brightness) {
+        dst.color.val = src.color.val;
+    }
+
+    if (src.fields & cmd_effect) {
+        dst.effect = src.effect;
+        dst.effectLast = true;
+    }
+    else if (src.fields & kCMD_COLOR_FIELDS) {
+        dst.effectLast = false;
+    }
+
+    dst.fields |= src.fields;
+}
@@ -0,0 +1,103 @@
+//
+//  PixelCommand.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PixelCommand_h
+#define PixelCommand_h
+
+#include "ColorUtils.h"
+
+// Commands arriving from MQTT or HTTP are not applied immediately. Instead they
+// are pushed into a small fixed ring and drained at the start of the next tick.
+// A burst (e.g. dragging the brightness slider in HA) coalesces into a single
+// pending command per area so we only build one new effect per area per frame
+// and area state never changes halfway through a frame.
+
+#define kCMD_QUEUE_LEN          16
+#define kDEFAULT_TRANSITION     0.5
+
+enum {
+    fx_none = 0,
+    fx_rainbow,
+    fx_wave,
+    fx_cylon,
+    fx_playback,
+    fx_sparkle,
+    fx_fire,
+    fx_plasma,
+    fx_gradient,
+};
+
+#define kFS_NAME_MAX            32      // LFS_NAME_MAX as the ESP8266 core builds LittleFS
+#define kFX_PATH_LEN            (kFS_NAME_MAX + 2)      // leading '/' and terminator
+#define kFX_MAX_STOPS           5
+
+enum {
+    fx_flag_positional  = 0x01,     // sample the area's layout positions rather than indexes
+    fx_flag_breathe     = 0x02,     // gradient: pulse brightness instead of scrolling
+};
+
+typedef struct {
+    uint16_t    hue;            // degrees
+    uint8_t     sat;            // percent
+    uint8_t     val;            // percent
+} FXStopRec, *FXStopPtr;
+
+typedef struct {
+    uint8_t     count;
+    FXStopRec   stops[kFX_MAX_STOPS];
+} FXStopsRec, *FXStopsPtr;
+
+typedef struct {
+    uint8_t     type;
+    uint8_t     flags;
+    float       rate;
+    float       width;
+    float       duration;
+    union {
+        char        path[kFX_PATH_LEN];     // effects that read from LittleFS
+        FXStopsRec  gradient;               // fx_gradient, shares the space so the journal record doesn't grow
+    };
+} PxlFXSpecRec, *PxlFXSpecPtr;
+
+enum {
+    cmd_state       = 0x01,
+    cmd_color       = 0x02,     // hue & saturation
+    cmd_brightness  = 0x04,
+    cmd_effect      = 0x08,
+};
+
+#define kCMD_COLOR_FIELDS   (cmd_state | cmd_color | cmd_brightness)
+
+typedef struct {
+    uint16_t        areaID;
+    uint8_t         fields;
+    bool            effectLast;     // effect arrived after any color fields
+    bool            isOn;
+    SHSVRec         color;
+    float           transition;     // < 0 for default
+    PxlFXSpecRec    effect;
+} PixelCommandRec, *PixelCommandPtr;
+
+class PixelCommandQueue {
+public:
+    PixelCommandQueue();
+
+    bool push(const PixelCommandRec &cmd);
+    bool pushAll(const PixelCommandRec *batch, uint16_t count);
+    bool pop(PixelCommandRec &cmd);
+    inline uint16_t count() { return used; }
+
+private:
+    static void merge(PixelCommandRec &dst, const PixelCommandRec &src);
+
+    PixelCommandRec cmds[kCMD_QUEUE_LEN];
+    uint16_t        head;
+    uint16_t        used;
+};
+
+#endif
@@ -12,10 +12,16 @@
 #include "PxlFX_Rainbow.h"
 #include "PxlFX_Wave.h"
 #include "PxlFX_Cylon.h"
+#include "PxlFX_Playback.h"
+#include "PxlFX_Sparkle.h"
+#include "PxlFX_Fire.h"
+#include "PxlFX_Plasma.h"
+#include "PxlFX_Gradient.h"
+#include "SyncClock.h"
+#include "LoopScheduler.h"
+#include "config.h"
 
-// ESP8266 show() is external to enforce ICACHE_RAM_ATTR execution
-extern "C" IRAM_ATTR void espShow(uint16_t pin, uint8_t *pixels, uint32_t numBytes);
-extern "C" IRAM_ATTR void espClear(uint16_t pin, uint32_t numBytes);
+// ESP8266 show() lives in espshow.cpp (declared in LEDChips.h) to enforce IRAM execution
 
 PixelController *gPixels = NULL;
 
@@ -40,6 +46,7 @@ PixelController::~PixelController() {
 void PixelController::init(uint16_t stripCount, StripInfoPtr stripInfo) {
     numPixels = 0;
     curTick = 0;
+    frameTime = 0;
 
     // Setup strips
     if ((strips = (StripPtr)malloc(stripCount * sizeof(StripRec))) != NULL) {
@@ -55,7 +62,7 @@ void PixelController::init(uint16_t stripCount, StripInfoPtr stripInfo) {
 
             pinMode(srcInfoP->pin, OUTPUT);
             digitalWrite(srcInfoP->pin, OUTPUT);
-            espClear(srcInfoP->pin, numPixels * sizeof(SPixelRec));
+            espClear(srcInfoP->chip, srcInfoP->pin, srcInfoP->len);
         }
 
         this->stripCount = stripCount;
@@ -68,16 +75,36 @@ void PixelController::init(uint16_t stripCount, StripInfoPtr stripInfo) {
     if ((pixels = (SPixelPtr)calloc(numPixels, sizeof(SPixelRec))) == NULL) {
         numPixels = 0;
     }
+    power.init(numPixels, kPOWER_BUDGET_MA);
 
     // Reset areas
     for (int aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++) {
         areas[aIdx].len = 0;
         areas[aIdx].map = nullptr;
+        areas[aIdx].mapKind = map_segmented;
+        areas[aIdx].mapFirst = 0;
+        areas[aIdx].pos = nullptr;
+        areas[aIdx].span = 0;
+        areas[aIdx].isOn = false;
+        areas[aIdx].dirtyState = false;
+        areas[aIdx].dirtyJournal = false;
+        areas[aIdx].effectSpec.type = fx_none;
         areas[aIdx].effect = nullptr;
+        areas[aIdx].keyFrames = nullptr;
+        areas[aIdx].keyInterval = 1;
+        areas[aIdx].keyPhase = 0;
+        areas[aIdx].lod = 0;
+        areas[aIdx].renderTime = 0;
     }
-
-    // If scheduled with attach_scheduled, tick can starve during setup, updating, etc.
-    ticker.attach_ms_scheduled_accurate(tickRate() * 1000, [this]() { this->performTick(); });
+    memset(&renderStats, 0, sizeof(renderStats));
+    frameLoad = 0;
+    lastTickTime = 0;
+    applyTime = 0;
+    lodChangeTick = 0;
+
+    // Frames are run from loop() by the scheduler which hands out the time
+    // between them to everything else.
+    gLoopScheduler.setFrame(tickRate() * 1000000, [this]() { this->performTick(); });
 }
 
 void PixelController::defineArea(uint16_t areaID, int16_t offset, int16_t len) {
@@ -107,10 +134,70 @@ void PixelController::defineArea(uint16_t areaID, uint16_t sectionCount, Section
 
         areas[areaID].len = areaLen;
         areas[areaID].map = areaMap;
+        areas[areaID].mapKind = classifyMap(areaMap, areaLen);
+        areas[areaID].mapFirst = areaLen > 0 ? areaMap[0] : 0;
+        areas[areaID].pos = buildPositions(sectionCount, sections, areaLen, areas[areaID].span);
         areas[areaID].baseColor = ColorUtils::none;
     }
 }
 
+// Lets effect render loops skip the map for areas that are a single run
+
+uint8_t PixelController::classifyMap(const uint16_t *map, uint16_t len) {
+    bool    forward = true;
+    bool    reverse = true;
+
+    for (uint16_t i=1; i<len && (forward || reverse); i++) {
+        forward = forward && map[i] == map[0] + i;
+        reverse = reverse && map[i] == map[0] - i;
+    }
+
+    return forward ? map_contiguous : reverse ? map_reversed : map_segmented;
+}
+
+bool PixelController::loadLayout(const char *path) {
+    return layout.load(path);
+}
+
+// Positions are the running physical distance from pixel to pixel in area
+// order, in units of the layout's pitch. All the float math happens here so
+// effects only need a table read per pixel. Areas with any pixel the layout
+// doesn't cover get no table and effects fall back to indexes.
+
+uint16_t *PixelController::buildPositions(uint16_t sectionCount, SectionPtr sections, uint16_t areaLen, uint16_t &span) {
+    uint16_t    *areaPos = nullptr;
+    uint16_t    posIdx = 0;
+    float       dist = 0.0;
+    float       lastX, lastY;
+
+    span = 0;
+    if (!layout.isLoaded() || (areaPos = (uint16_t *)malloc(sizeof(uint16_t) * areaLen)) == NULL) {
+        return nullptr;
+    }
+
+    for (int sIdx=0; sIdx<sectionCount; sIdx++) {
+        int     lastIdx = sections[sIdx].offset + sections[sIdx].len;
+
+        for (uint16_t logIdx=sections[sIdx].offset; logIdx<lastIdx; logIdx++, posIdx++) {
+            float   x, y;
+
+            if (!layout.pointFor(logIdx, x, y)) {
+                free(areaPos);
+                return nullptr;
+            }
+            if (posIdx > 0) {
+                dist += hypotf(x - lastX, y - lastY) / layout.getPitch();
+            }
+            areaPos[posIdx] = min(dist * kPOS_ONE, 65535.0f);
+            lastX = x;
+            lastY = y;
+        }
+    }
+    span = posIdx > 0 ? areaPos[posIdx - 1] : 0;
+
+    return areaPos;
+}
+
 uint16_t PixelController::logicalIndexToPixelIndex(uint16_t logicalIdx) {
     StripPtr    stripP = strips;
     uint16_t    pixelIdx = 0;
@@ -134,15 +221,16 @@ void PixelController::show() {
     if (pixels != NULL) {
         StripPtr    stripP;
         int         sIdx;
+        uint16_t    scale = power.frameScale();     // same scale for every strip
 
         for (sIdx=0, stripP=strips; sIdx<stripCount; sIdx++, stripP++) {
-             // Given SK6812RGBW reset time is so short (80µS) we are very unlikely
-             // to need to wait. Especially with multiple strips as the data for each
-             // LED takes 40µS to send. 
+             // Given reset times are so short (80µS SK6812, 280µS WS2812B) we are
+             // unlikely to need to wait. Especially with multiple strips as the data
+             // for each LED takes 30-40µS to send.
             while (!stripP->canShow()) { yield(); }
 
             noInterrupts();
-            espShow(stripP->info.pin, (uint8_t *)&pixels[stripP->info.offset], stripP->info.len * sizeof(SPixelRec));
+            espShow(stripP->info.chip, stripP->info.pin, &pixels[stripP->info.offset], stripP->info.len, scale);
             interrupts();
             
             stripP->lastShown = micros();
@@ -155,6 +243,7 @@ void PixelController::show() {
 void PixelController::performTick() {
     PixelAreaPtr    area = areas;
     bool            needsShow = false;
+    uint32_t        tickStart = micros();
 #if SHOW_TICK_TIME == 1
     static uint32_t avgTime = 0;
     static uint32_t avgInterval = 0;
@@ -162,18 +251,33 @@ void PixelController::performTick() {
     uint32_t        start = micros();
 #endif
 
-    for (int aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++, area++) {
-        PxlFX   *effect = area->effect;
+    // Apply anything that arrived since the last tick before rendering so
+    // area state is stable for the whole frame.
+    applyCommands();
+    frameTime = gSyncClock.now();
+    tickRenderTime = 0;
+    tickLerpTime = 0;
 
-        if (area->len > 0 && effect != nullptr) {
+    for (int aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++, area++) {
+        if (area->len > 0 && area->effect != nullptr) {
             needsShow = true;
-            if (effect->update()) {
-                area->effect = nullptr;
-                delete effect;
+            if (renderArea(area)) {
+                // A finished effect no longer describes the area, so it isn't
+                // journaled or restored, unless what it left is meant to stay
+                if (area->effectSpec.type != fx_none && !area->effect->holdsWhenComplete()) {
+                    area->effectSpec.type = fx_none;
+                    area->dirtyJournal = true;
+                }
+                clearAreaEffect(aIdx);
             }
         }
     }
 
+    if (needsShow) {
+        renderStats.renderTime = (renderStats.renderTime / 8) * 7 + tickRenderTime / 8;
+        renderStats.lerpTime = (renderStats.lerpTime / 8) * 7 + tickLerpTime / 8;
+    }
+
 #if SHOW_TICK_TIME == 1
     uint32_t time = micros() - start;
     uint32_t interval = start - lastStart;
@@ -191,103 +295,547 @@ void PixelController::performTick() {
         show();
     }
 
+    lastTickTime = micros() - tickStart;
+    updateLOD(lastTickTime);
     curTick++;
 }
 
+// Effects that opt in (PxlFX::keyframeInterval) only render every few ticks.
+// The output in between is a linear blend from the previous keyframe to the
+// latest one so motion stays smooth at the full output rate. That puts the
+// area a keyframe interval behind, which for the slow effects that opt in
+// isn't noticeable.
+
+bool PixelController::renderArea(PixelAreaPtr area) {
+    bool        finished = false;
+    uint32_t    start = micros();
+
+    if (area->keyFrames == nullptr || area->keyPhase >= area->keyInterval) {
+        uint32_t    elapsed;
+
+        finished = area->effect->update();
+        elapsed = micros() - start;
+        tickRenderTime += elapsed;
+        area->renderTime = (area->renderTime / 4) * 3 + elapsed / 4;
+
+        if (area->keyFrames != nullptr && !finished) {
+            captureKeyframe(area);
+            renderStats.keyframes++;
+        }
+    }
+
+    if (area->keyFrames != nullptr && !finished) {
+        start = micros();
+        interpolateArea(area);
+        tickLerpTime += micros() - start;
+        renderStats.lerpFrames++;
+    }
+
+    return finished;
+}
+
+void PixelController::captureKeyframe(PixelAreaPtr area) {
+    SPixelRec   *prevKey = area->keyFrames;
+    SPixelRec   *nextKey = prevKey + area->len;
+    uint16_t    *mapIdx = area->map;
+
+    if (area->keyPhase == kKEYFRAME_NONE) {
+        for (int i=0; i<area->len; i++, mapIdx++) {
+            prevKey[i] = nextKey[i] = pixels[*mapIdx];      // first one, nothing to blend from
+        }
+    }
+    else {
+        memcpy(prevKey, nextKey, area->len * sizeof(SPixelRec));
+        for (int i=0; i<area->len; i++, mapIdx++) {
+            nextKey[i] = pixels[*mapIdx];
+        }
+    }
+    area->keyPhase = 0;
+}
+
+void PixelController::interpolateArea(PixelAreaPtr area) {
+    SPixelRec   *prevKey = area->keyFrames;
+    SPixelRec   *nextKey = area->keyFrames + area->len;
+    uint16_t    *mapIdx = area->map;
+    int32_t     weight = ((area->keyPhase + 1) * 256) / area->keyInterval;      // 0 - 256
+
+    for (int i=0; i<area->len; i++, mapIdx++, prevKey++, nextKey++) {
+        setPixel(*mapIdx, ColorUtils::blend(*prevKey, *nextKey, weight));
+    }
+    area->keyPhase++;
+}
+
+// Detail (compute every Nth pixel) and render rate (ticks per keyframe) for
+// each level of detail
+
+static const uint8_t kLODDetail[kLOD_MAX + 1]   = { 1, 2, 2, 4 };
+static const uint8_t kLODRate[kLOD_MAX + 1]     = { 1, 1, 2, 2 };
+
+void PixelController::configureKeyframes(PixelAreaPtr area) {
+    uint8_t     interval = area->effect->keyframeInterval() * kLODRate[area->lod];
+
+    if (interval > 1 && area->keyFrames == nullptr) {
+        if ((area->keyFrames = (SPixelRec *)malloc(2 * area->len * sizeof(SPixelRec))) != NULL) {
+            area->keyPhase = kKEYFRAME_NONE;
+        }
+        else {
+            interval = 1;
+        }
+    }
+    else if (interval == 1 && area->keyFrames != nullptr) {
+        free(area->keyFrames);
+        area->keyFrames = nullptr;
+    }
+    area->keyInterval = interval;
+}
+
+void PixelController::applyLOD(PixelAreaPtr area, uint8_t lod) {
+    area->lod = lod;
+    if (area->effect != nullptr) {
+        area->effect->setDetail(kLODDetail[lod]);
+        configureKeyframes(area);
+    }
+    lodChangeTick = curTick;
+}
+
+// Pick on the area whose effect costs the most per tick when over budget and
+// give back detail, highest level first, when there's room again. Changes are
+// spaced out so the load average reflects the last one before the next.
+
+void PixelController::updateLOD(uint32_t tickDuration) {
+    uint32_t        load;
+    PixelAreaPtr    area = areas;
+    PixelAreaPtr    pick = nullptr;
+
+    frameLoad = (frameLoad / 8) * 7 + tickDuration / 8;
+    if (curTick - lodChangeTick < kLOD_SETTLE_TICKS) {
+        return;
+    }
+
+    load = (frameLoad * 100) / (uint32_t)(tickRate() * 1000000);
+    if (load > kLOD_HIGH_LOAD) {
+        uint32_t    maxCost = 0;
+
+        for (int aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++, area++) {
+            if (area->effect != nullptr && area->lod < kLOD_MAX && area->renderTime / area->keyInterval > maxCost) {
+                maxCost = area->renderTime / area->keyInterval;
+                pick = area;
+            }
+        }
+        if (pick != nullptr) {
+            applyLOD(pick, pick->lod + 1);
+        }
+    }
+    else if (load < kLOD_LOW_LOAD) {
+        for (int aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++, area++) {
+            if (area->lod > 0 && (pick == nullptr || area->lod > pick->lod)) {
+                pick = area;
+            }
+        }
+        if (pick != nullptr) {
+            applyLOD(pick, pick->lod - 1);
+        }
+    }
+}
+
 float PixelController::tickTime(uint32_t startTick) {
     return (float)(curTick - startTick) * tickRate();
 }
 
+// Position (0 - 1) within a repeating cycle of period seconds, taken from the
+// synced clock rather than counted from when the effect started so nodes
+// running the same effect stay in phase. Negative periods run backward.
+
+float PixelController::framePhase(float period) {
+    uint32_t    periodMS = fabsf(period) * 1000.0f;
+    float       phase = 0.0;
+
+    if (periodMS > 0) {
+        phase = (float)(frameTime % periodMS) / (float)periodMS;
+        if (period < 0.0 && phase > 0.0) {
+            phase = 1.0 - phase;
+        }
+    }
+
+    return phase;
+}
+
 void PixelController::resetArea(uint16_t areaID) {
     setAreaColor(areaID, ColorUtils::white.withVal(0.50), false);
 }
 
-void PixelController::recordState(uint16_t areaID, Print &output) {
+// Repaint an idle area from its current state, e.g. after a temporary overlay
+// on top of it has been removed. Areas running an effect repaint themselves.
+
+void PixelController::refreshArea(uint16_t areaID) {
+    PixelAreaPtr    area = &areas[areaID];
+
+    if (area->effect == nullptr && area->baseColor.valid()) {
+        setAreaColor(areaID, area->baseColor, area->isOn);
+    }
+}
+
+size_t PixelController::recordState(uint16_t areaID, char *buffer, size_t bufferLen) {
     StaticJsonDocument<256> jsonDoc;
     PixelAreaPtr            area = &areas[areaID];
 
-    jsonDoc[F("state")] = area->isOn ? "ON" : "OFF";
-    jsonDoc[F("brightness")] = (int)(area->baseColor.val * 100);
-    jsonDoc[F("color_mode")] = "hs";
-    jsonDoc[F("effect")] = "none";   // for now
-    jsonDoc[F("color")]["h"] = area->baseColor.hue;
-    jsonDoc[F("color")]["s"] = area->baseColor.sat * 100.0;
-    serializeJson(jsonDoc, output);
+    // Keys and values are string literals so they are stored by reference
+    // rather than copied into the document.
+    jsonDoc["state"] = area->isOn ? "ON" : "OFF";
+    jsonDoc["brightness"] = (int)(area->baseColor.val * 100);
+    jsonDoc["color_mode"] = "hs";
+    jsonDoc["effect"] = effectName(area->effectSpec.type);
+    if (area->effectSpec.type != fx_none) {
+        // not part of HA's schema, but they let a retained state restore rebuild the same effect
+        jsonDoc["rate"] = area->effectSpec.rate;
+        jsonDoc["width"] = area->effectSpec.width;
+    }
+    jsonDoc["color"]["h"] = area->baseColor.hue;
+    jsonDoc["color"]["s"] = area->baseColor.sat * 100.0;
+
+    return serializeJson(jsonDoc, buffer, bufferLen);
 }
 
-bool PixelController::getUpdatedState(uint16_t areaID, Print &output) {
+size_t PixelController::getUpdatedState(uint16_t areaID, char *buffer, size_t bufferLen) {
     PixelAreaPtr    areaP = &areas[areaID];
-    bool            wasUpdated = false;
+    size_t          stateLen = 0;
 
     if (areaP->dirtyState) {
         areaP->dirtyState = false;
-        wasUpdated = true;
 
-        recordState(areaID, output);
+        stateLen = recordState(areaID, buffer, bufferLen);
     }
 
-    return wasUpdated;
+    return stateLen;
 }
 
-void PixelController::handleWebCommand(const JsonDocument &json) {
-    PxlFX   *newEffect = NULL;
-    String  effectName = json["name"];
-    int     area = json["area"];
+bool PixelController::handleWebCommand(const JsonDocument &json) {
+    PixelCommandRec cmd;
 
-    if (effectName == "rainbow")    { newEffect = new PxlFX_Rainbow(gPixels, json); }
-    else if (effectName == "wave")  { newEffect = new PxlFX_Wave(gPixels, json); }
-    else if (effectName == "cylon")  { newEffect = new PxlFX_Cylon(gPixels, json); }
+    cmd.areaID = json["area"];
+    cmd.fields = cmd_effect;
 
-    if (newEffect != NULL) {
-        gPixels->setAreaEffect(area, newEffect);
-    }
+    return parseEffect(json.as<JsonVariantConst>(), json["name"], cmd.effect) &&
+        cmd.areaID < kMAX_PIXEL_AREAS && cmd.effect.type != fx_none && queueCommand(cmd);
 }
 
 void PixelController::handleMQTTCommand(const JsonDocument &json) {
-    PixelAreaPtr mainArea = &areas[0];
-
-    if (mainArea->len > 0) {
-        String  state = json["state"];
-        SHSVRec newColor = mainArea->baseColor;
-        bool    dirtyColor = false;
-        bool    newState = (state == "ON");
-
-        if (json.containsKey("color")) {
-            newColor.hue = json["color"]["h"];
-            newColor.sat = ((float)json["color"]["s"] / 100.0);
-            dirtyColor = true;
+    PixelCommandRec cmd;
+
+    cmd.areaID = area_main;
+    parseCommand(json.as<JsonVariantConst>(), cmd);
+    if (!(cmd.fields & cmd_state)) {
+        cmd.isOn = false;       // HA always sends state, treat anything else as off
+        cmd.fields |= cmd_state;
+    }
+
+    queueCommand(cmd);
+}
+
+// Home Assistant's JSON light schema (state, color, brightness, transition and
+// effect), shared by MQTT and /$commands. Only the fields present are set.
+
+void PixelController::parseCommand(JsonVariantConst json, PixelCommandRec &cmd) {
+    cmd.fields = 0;
+    cmd.transition = json.containsKey("transition") ? json["transition"] : -1.0;
+
+    if (json.containsKey("state")) {
+        const char  *state = json["state"];
+
+        cmd.isOn = state != nullptr && !strcmp(state, "ON");
+        cmd.fields |= cmd_state;
+    }
+
+    if (json.containsKey("color")) {
+        cmd.color.hue = json["color"]["h"];
+        cmd.color.sat = ((float)json["color"]["s"] / 100.0);
+        cmd.fields |= cmd_color;
+    }
+
+    if (json.containsKey("brightness")) {
+        cmd.color.val = ((float)json["brightness"] / 100.0);
+        cmd.fields |= cmd_brightness;
+    }
+
+    if (json.containsKey("effect")) {
+        parseEffect(json, json["effect"], cmd.effect);
+        if (cmd.effect.type != fx_none) {
+            cmd.fields |= cmd_effect;
         }
+    }
+}
+
+bool PixelController::queueCommand(const PixelCommandRec &cmd) {
+    bool    queued = commands.push(cmd);
+
+    if (!queued) {
+        Serial.println(F("Command queue full, dropping command"));
+    }
+
+    return queued;
+}
+
+bool PixelController::queueCommands(const PixelCommandRec *batch, uint16_t count) {
+    bool    queued = commands.pushAll(batch, count);
+
+    if (!queued) {
+        Serial.println(F("Command queue full, dropping batch"));
+    }
+
+    return queued;
+}
+
+bool PixelController::applyCommands() {
+    PixelCommandRec cmd;
+    bool            applied = false;
+
+    while (commands.pop(cmd)) {
+        applyCommand(cmd);
+        applied = true;
+    }
+    if (applied) {
+        applyTime = micros();
+    }
+
+    return applied;
+}
+
+void PixelController::applyCommand(const PixelCommandRec &cmd) {
+    PixelAreaPtr    area;
+
+    // Every producer ends up here, so this is the one place the area is checked
+    if (cmd.areaID >= kMAX_PIXEL_AREAS || (area = &areas[cmd.areaID])->len <= 0) {
+        return;
+    }
 
-        if (json.containsKey("brightness")) {
-            newColor.val = ((float)json["brightness"] / 100.0);
-            dirtyColor = true;
+    if ((cmd.fields & cmd_effect) && !cmd.effectLast) {
+        setAreaEffect(cmd.areaID, cmd.effect);
+    }
+
+    if (cmd.fields & kCMD_COLOR_FIELDS) {
+        SHSVRec newColor = area->baseColor;
+        bool    newState = (cmd.fields & cmd_state) ? cmd.isOn : area->isOn;
+
+        if (cmd.fields & cmd_color) {
+            newColor.hue = cmd.color.hue;
+            newColor.sat = cmd.color.sat;
+        }
+        if (cmd.fields & cmd_brightness) {
+            newColor.val = cmd.color.val;
+        }
+
+        if (area->isOn != newState) {
+            setAreaColor(cmd.areaID, newColor, newState, cmd.transition >= 0.0 ? cmd.transition : kDEFAULT_TRANSITION);
+        }
+        else if (cmd.fields & (cmd_color | cmd_brightness)) {
+            setAreaColor(cmd.areaID, newColor, newState, max(0.0f, cmd.transition));
         }
+    }
+
+    if ((cmd.fields & cmd_effect) && cmd.effectLast) {
+        setAreaEffect(cmd.areaID, cmd.effect);
+    }
+}
+
+bool PixelController::getUpdatedJournalState(uint16_t areaID, PixelAreaStateRec &state) {
+    PixelAreaPtr    area = &areas[areaID];
+    bool            wasUpdated = false;
+
+    if (area->dirtyJournal) {
+        area->dirtyJournal = false;
+        wasUpdated = true;
+
+        getAreaState(areaID, state);
+    }
+
+    return wasUpdated;
+}
+
+void PixelController::getAreaState(uint16_t areaID, PixelAreaStateRec &state) {
+    PixelAreaPtr    area = &areas[areaID];
+
+    state.isOn = area->isOn;
+    state.color = area->baseColor;
+    state.effect = area->effectSpec;
+}
+
+void PixelController::restoreAreaState(uint16_t areaID, const PixelAreaStateRec &state) {
+    setAreaColor(areaID, state.color, state.isOn);
+    if (state.effect.type != fx_none) {
+        setAreaEffect(areaID, state.effect);
+    }
+}
 
-        if (mainArea->isOn != newState) {
-            float   transition = json.containsKey("transition") ? json["transition"] : 0.5;
+uint8_t PixelController::effectFlags(const char *mode) {
+    uint8_t flags = 0;
 
-            setAreaColor(0, newColor, newState, transition);
+    if (mode != nullptr) {
+        if (!strcmp(mode, "positional"))    { flags = fx_flag_positional; }
+        else if (!strcmp(mode, "breathe"))  { flags = fx_flag_breathe; }
+    }
+
+    return flags;
+}
+
+// Gradient stops arrive as an array of { "h", "s", "v" } (s & v in percent) from
+// MQTT or playlists, or as "h,s,v;h,s,v;..." from a query string
+
+void PixelController::effectStops(JsonVariantConst src, FXStopsRec &gradient) {
+    gradient.count = 0;
+
+    if (src.is<JsonArrayConst>()) {
+        for (JsonObjectConst stop : src.as<JsonArrayConst>()) {
+            FXStopPtr   dst;
+
+            if (gradient.count >= kFX_MAX_STOPS) {
+                break;
+            }
+            dst = &gradient.stops[gradient.count];
+            dst->hue = (uint16_t)(stop["h"] | 0) % 360;
+            dst->sat = min(100, stop["s"] | 100);
+            dst->val = min(100, stop["v"] | 100);
+            gradient.count++;
         }
-        else if (dirtyColor) {
-            setAreaColor(0, newColor, newState);
+    }
+    else if (src.is<const char *>()) {
+        const char  *text = src.as<const char *>();
+
+        while (text != nullptr && *text != 0 && gradient.count < kFX_MAX_STOPS) {
+            FXStopPtr   dst = &gradient.stops[gradient.count];
+            int         hue = 0, sat = 100, val = 100;
+
+            if (sscanf(text, "%d,%d,%d", &hue, &sat, &val) >= 1) {
+                dst->hue = abs(hue) % 360;
+                dst->sat = constrain(sat, 0, 100);
+                dst->val = constrain(val, 0, 100);
+                gradient.count++;
+            }
+            if ((text = strchr(text, ';')) != nullptr) {
+                text++;
+            }
         }
     }
 }
 
-void PixelController::setAreaEffect(uint16_t areaID, PxlFX *effect) {
-    PixelAreaPtr     area = &areas[areaID];
+// Shared by /$effect, MQTT and playlists. Values are converted rather than
+// defaulted with | since query parameters arrive as strings. Home Assistant only
+// sends the effect's name so a missing rate or width takes the effect's default
+// (the same as the web page's). A file path that doesn't fit is rejected
+// (type fx_none) rather than truncated to a different file.
+
+static const struct {
+    const char  *name;
+    float       rate;
+    float       width;
+} effectInfo[] = {
+    { "none",       0.0, 0.0 },     // fx_none
+    { "rainbow",    2.0, 32.0 },    // fx_rainbow
+    { "wave",       2.0, 32.0 },    // fx_wave
+    { "cylon",      2.0, 32.0 },    // fx_cylon
+    { "playback",   0.0, 0.0 },     // fx_playback
+    { "sparkle",    0.0, 0.0 },     // fx_sparkle, 0 picks the life and count from the area
+    { "fire",       1.0, 8.0 },     // fx_fire
+    { "plasma",     0.5, 16.0 },    // fx_plasma
+    { "gradient",   0.0, 0.0 },     // fx_gradient, static across the whole area
+};
+
+bool PixelController::parseEffect(JsonVariantConst json, const char *name, PxlFXSpecRec &spec) {
+    spec.type = effectType(name);
+    spec.flags = effectFlags(json["mode"]);
+    spec.rate = json.containsKey("rate") ? json["rate"] : effectInfo[spec.type].rate;
+    spec.width = json.containsKey("width") ? json["width"] : effectInfo[spec.type].width;
+    spec.duration = 0.0;
+
+    if (spec.type == fx_gradient) {
+        effectStops(json["stops"], spec.gradient);
+    }
+    else if (strlcpy(spec.path, json["file"] | "", sizeof(spec.path)) >= sizeof(spec.path)) {
+        spec.type = fx_none;
+        spec.path[0] = 0;
+        return false;
+    }
 
-    if (area->map != NULL && area->len > 0) {
-        PxlFX   *oldEffect = area->effect;
+    return true;
+}
 
-        if (oldEffect != nullptr) {
-            area->effect = nullptr;
-            delete oldEffect;
+uint8_t PixelController::effectType(const char *name) {
+    for (uint8_t type=fx_none + 1; name != nullptr && type<sizeof(effectInfo) / sizeof(effectInfo[0]); type++) {
+        if (!strcmp(name, effectInfo[type].name)) {
+            return type;
         }
+    }
+
+    return fx_none;
+}
+
+const char *PixelController::effectName(uint8_t type) {
+    return effectInfo[type < sizeof(effectInfo) / sizeof(effectInfo[0]) ? type : fx_none].name;
+}
+
+PxlFX *PixelController::createEffect(const PxlFXSpecRec &spec) {
+    PxlFX   *effect = nullptr;
+
+    switch (spec.type) {
+        case fx_rainbow:    effect = new PxlFX_Rainbow(this, spec.rate, spec.width, spec.duration, spec.flags); break;
+        case fx_wave:       effect = new PxlFX_Wave(this, spec.rate, spec.width, spec.duration, spec.flags); break;
+        case fx_cylon:      effect = new PxlFX_Cylon(this, spec.rate, spec.width, spec.duration, spec.flags); break;
+        case fx_playback:   effect = new PxlFX_Playback(this, spec.path, spec.duration); break;
+        case fx_sparkle:    effect = new PxlFX_Sparkle(this, spec.rate, spec.width, spec.duration); break;
+        case fx_fire:       effect = new PxlFX_Fire(this, spec.rate, spec.width, spec.duration, spec.flags); break;
+        case fx_plasma:     effect = new PxlFX_Plasma(this, spec.rate, spec.width, spec.duration, spec.flags); break;
+        case fx_gradient:   effect = new PxlFX_Gradient(this, spec.gradient, spec.rate, spec.width, spec.duration, spec.flags); break;
+    }
+
+    return effect;
+}
+
+void PixelController::setAreaEffect(uint16_t areaID, PxlFX *effect) {
+    PixelAreaPtr     area = areaID < kMAX_PIXEL_AREAS ? &areas[areaID] : nullptr;
+
+    if (effect != nullptr && area != nullptr && area->map != NULL && area->len > 0) {
+        clearAreaEffect(areaID);
 
         effect->setArea(area);
         area->effect = effect;
         area->dirtyState = true;
+
+        effect->setDetail(kLODDetail[area->lod]);
+        configureKeyframes(area);
+        area->renderTime = 0;
+    }
+    else if (effect != nullptr) {
+        delete effect;      // undefined area
+    }
+}
+
+void PixelController::setAreaEffect(uint16_t areaID, const PxlFXSpecRec &spec) {
+    PixelAreaPtr    area;
+    PxlFX           *effect;
+
+    // check the area before allocating anything for it
+    if (areaID >= kMAX_PIXEL_AREAS || (area = &areas[areaID])->map == NULL || area->len <= 0) {
+        return;
+    }
+
+    if ((effect = createEffect(spec)) != nullptr) {
+        setAreaEffect(areaID, effect);
+        area->effectSpec = spec;
+        area->dirtyJournal = true;
+    }
+}
+
+void PixelController::clearAreaEffect(uint16_t areaID) {
+    PixelAreaPtr    area = &areas[areaID];
+    PxlFX           *oldEffect = area->effect;
+
+    if (oldEffect != nullptr) {
+        area->effect = nullptr;
+        delete oldEffect;
+    }
+    if (area->keyFrames != nullptr) {
+        free(area->keyFrames);
+        area->keyFrames = nullptr;
+        area->keyInterval = 1;
     }
 }
 
@@ -311,39 +859,11 @@ void PixelController::setAreaColor(uint16_t areaID, SHSVRec color, bool isOn, fl
         setAreaEffect(areaID, effect);
         area->baseColor = color;
         area->isOn = isOn;
+        area->effectSpec.type = fx_none;
+        area->dirtyJournal = true;
     }
 }
 
-void PixelController::beginStressTest() {
-    struct StressStuff {
-        Ticker  *stressTicker;
-        float   stressAngle;
-        int     stressCount;
-    };
-    StressStuff *stuff = (StressStuff *)malloc(sizeof(StressStuff));
-
-    stuff->stressTicker = new Ticker();
-    stuff->stressAngle = 0.0;
-    stuff->stressCount = 0;
-    
-    stuff->stressTicker->attach_scheduled(0.33, [this, stuff] {
-        if (!(stuff->stressCount % 2)) {
-            this->setAreaColor(0, SHSVRec(stuff->stressAngle, 1.0, 0.4), true);
-            stuff->stressAngle += 15.0;
-            if (stuff->stressAngle >= 360.0) {
-                stuff->stressAngle -= 360.0;
-            }
-        }
-        else {
-            PxlFX_Wave  *waveEffect = new PxlFX_Wave(this, 0.5, 18.0);
-
-            this->setAreaEffect(0, waveEffect);
-        }
-        
-        stuff->stressCount++;
-    });
-}
-
 void PixelController::dumpInfo() {
     Serial.printf("%d strips\n", stripCount);
     for (int i=0; i<stripCount; i++) {
@@ -10,8 +10,11 @@
 #define PixelController_h
 
 #include "ColorUtils.h"
+#include "PixelCommand.h"
+#include "LEDChips.h"
+#include "PowerLimiter.h"
+#include "PixelLayout.h"
 #include <ArduinoJson.h>
-#include <Ticker.h>
 
 // Note:
 // To future me when I wonder why this seems insane:
@@ -47,22 +50,70 @@
 // could define an area on top of the main area where our coffee maker normally 
 // sits which could be illuminated differently to indicate when it is on and 
 // revert to the main area color or effect when off.
+//
+// Strips default to SK6812 GRBW. A strip of another chip type just names it,
+// e.g. { D1, 60, false, strip_ws2812_grb }. The pixel buffer stays GRBW and
+// the conversion happens as the strip is shown (see LEDChips.h).
+//
+// If a layout has been loaded (loadLayout, see PixelLayout.h) before an area
+// is defined, the area also gets a table of each pixel's physical distance
+// along the area so effects can run in a positional mode that travels
+// smoothly across corners and gaps.
 
 #define kMAX_PIXEL_AREAS    10
-#define kSTRIP_RESET_DUR    80UL    // Min reset time for SK6812RGBW. Other strips may be different.
+#define kKEYFRAME_NONE      0xFF    // keyPhase before the first keyframe
+
+// Level of detail. When frames take too long the most expensive area steps
+// down a level, when there's plenty of headroom an area steps back up.
+#define kLOD_MAX            3
+#define kLOD_HIGH_LOAD      85      // % of the tick period
+#define kLOD_LOW_LOAD       55
+#define kLOD_SETTLE_TICKS   60      // min ticks between changes
 
 class PxlFX;
 
+enum {
+    map_segmented = 0,      // anything else, needs the map
+    map_contiguous,         // map[i] == mapFirst + i
+    map_reversed,           // map[i] == mapFirst - i
+};
+
 typedef struct {
     int16_t     len;
     uint16_t    *map;
+    uint8_t     mapKind;
+    uint16_t    mapFirst;
+    uint16_t    *pos;           // 10.6 fixed point LEDs from the first pixel, nullptr w/o layout
+    uint16_t    span;           // pos of the last pixel
 
     bool        isOn;
-    bool        dirtyState;
+    bool        dirtyState;     // needs publishing
+    bool        dirtyJournal;   // needs persisting
     SHSVRec     baseColor;
+    PxlFXSpecRec effectSpec;    // type is fx_none for plain colors
     PxlFX       *effect;
+
+    SPixelRec   *keyFrames;     // previous & next keyframes (2 * len) when interpolating
+    uint8_t     keyInterval;    // ticks per keyframe
+    uint8_t     keyPhase;       // ticks since the last keyframe
+
+    uint8_t     lod;            // level of detail, 0 is full quality
+    uint32_t    renderTime;     // µS per effect update, running average
 } PixelAreaRec, *PixelAreaPtr;
 
+typedef struct {
+    bool            isOn;
+    SHSVRec         color;
+    PxlFXSpecRec    effect;
+} PixelAreaStateRec, *PixelAreaStatePtr;
+
+typedef struct {
+    uint32_t        renderTime;     // µS per frame running effects, running average
+    uint32_t        lerpTime;       // µS per frame interpolating keyframes, running average
+    uint32_t        keyframes;      // effect updates that fed interpolation
+    uint32_t        lerpFrames;     // area frames produced by interpolation
+} RenderStatsRec, *RenderStatsPtr;
+
 class PixelController {
 public:
     typedef struct StripInfo {
@@ -70,8 +121,9 @@ public:
         int16_t         offset;
         int16_t         len;
         bool            reversed;
+        uint8_t         chip;
 
-        StripInfo(int16_t inPin, int16_t inLen, bool inReversed) { pin = inPin; len = inLen; reversed = inReversed; }
+        StripInfo(int16_t inPin, int16_t inLen, bool inReversed, uint8_t inChip = kDEFAULT_STRIP_CHIP) { pin = inPin; len = inLen; reversed = inReversed; chip = inChip; }
     } StripInfoRec, *StripInfoPtr;
 
     typedef struct {
@@ -85,7 +137,7 @@ public:
                 lastShown = now;
             }
 
-            return (now - lastShown) >= kSTRIP_RESET_DUR;
+            return (now - lastShown) >= chipResetDur(info.chip);
         }
     } StripRec, *StripPtr;
 
@@ -107,31 +159,67 @@ public:
 
     void defineArea(uint16_t areaID, int16_t offset, int16_t len);
     void defineArea(uint16_t areaID, uint16_t sectionCount, SectionPtr sections);
+    bool loadLayout(const char *path = kLAYOUT_PATH);
 
     void show();
     void performTick();
     float tickTime(uint32_t startTick);
+    float framePhase(float period);
     inline uint32_t getTick() { return curTick; }
+    inline uint64_t getFrameTime() { return frameTime; }
   
     void resetArea(uint16_t areaID);
-    void recordState(uint16_t areaID, Print &output);
-    bool getUpdatedState(uint16_t areaID, Print &output);
-    void handleWebCommand(const JsonDocument &json);
+    void refreshArea(uint16_t areaID);
+    size_t recordState(uint16_t areaID, char *buffer, size_t bufferLen);
+    size_t getUpdatedState(uint16_t areaID, char *buffer, size_t bufferLen);
+    bool getUpdatedJournalState(uint16_t areaID, PixelAreaStateRec &state);
+    void getAreaState(uint16_t areaID, PixelAreaStateRec &state);
+    void restoreAreaState(uint16_t areaID, const PixelAreaStateRec &state);
+    bool handleWebCommand(const JsonDocument &json);
     void handleMQTTCommand(const JsonDocument &json);
+    bool queueCommand(const PixelCommandRec &cmd);
+    bool queueCommands(const PixelCommandRec *batch, uint16_t count);
     void setAreaEffect(uint16_t areaID, PxlFX *effect);
+    void setAreaEffect(uint16_t areaID, const PxlFXSpecRec &spec);
+    void clearAreaEffect(uint16_t areaID);
     void setAreaColor(uint16_t areaID, SHSVRec color, bool isOn=true, float duration=0.0);
 
-    inline void setPixel(uint16_t pixelIdx, SPixelRec pixel) { pixels[pixelIdx] = pixel; }   // not awesome
+    inline void setPixel(uint16_t pixelIdx, SPixelRec pixel) { power.replace(pixels[pixelIdx], pixel); pixels[pixelIdx] = pixel; }   // not awesome
+    inline SPixelRec getPixel(uint16_t pixelIdx) { return pixels[pixelIdx]; }
+    inline PixelAreaPtr getArea(uint16_t areaID) { return &areas[areaID]; }
+    inline const PowerStatsRec &getPowerStats() { return power.getStats(); }
+    inline const RenderStatsRec &getRenderStats() { return renderStats; }
+    inline uint32_t getFrameLoad() { return frameLoad; }
+    inline uint32_t getLastTickTime() { return lastTickTime; }
+    inline uint32_t getApplyTime() { return applyTime; }
+    inline uint32_t getPowerBudget() { return power.getBudget(); }
+
+    static uint8_t effectType(const char *name);
+    static const char *effectName(uint8_t type);
+    static uint8_t effectFlags(const char *mode);
+    static void effectStops(JsonVariantConst src, FXStopsRec &gradient);
+    static bool parseEffect(JsonVariantConst json, const char *name, PxlFXSpecRec &spec);
+    static void parseCommand(JsonVariantConst json, PixelCommandRec &cmd);
+    PxlFX *createEffect(const PxlFXSpecRec &spec);
 
-    void beginStressTest();
     void dumpInfo();
 
 private:
     void init(uint16_t stripCount, StripInfoPtr stripInfo);
     uint16_t logicalIndexToPixelIndex(uint16_t logicalIdx);
+    static uint8_t classifyMap(const uint16_t *map, uint16_t len);
+    uint16_t *buildPositions(uint16_t sectionCount, SectionPtr sections, uint16_t areaLen, uint16_t &span);
+    bool applyCommands();
+    bool renderArea(PixelAreaPtr area);
+    void captureKeyframe(PixelAreaPtr area);
+    void interpolateArea(PixelAreaPtr area);
+    void configureKeyframes(PixelAreaPtr area);
+    void updateLOD(uint32_t tickDuration);
+    void applyLOD(PixelAreaPtr area, uint8_t lod);
+    void applyCommand(const PixelCommandRec &cmd);
 
     uint32_t        curTick;
-    Ticker          ticker;
+    uint64_t        frameTime;  // synced wall clock mS, see SyncClock
 
     uint16_t        numPixels;  // aka LEDS but each "pixel" is four LEDs
     SPixelPtr       pixels;     
@@ -140,6 +228,16 @@ private:
     uint16_t        stripCount;
 
     PixelAreaRec    areas[kMAX_PIXEL_AREAS];
+    PixelCommandQueue commands;
+    PowerLimiter    power;
+    RenderStatsRec  renderStats;
+    uint32_t        tickRenderTime;
+    uint32_t        tickLerpTime;
+    uint32_t        frameLoad;      // µS per tick, running average
+    uint32_t        lastTickTime;   // µS
+    uint32_t        applyTime;      // micros() when queued commands were last applied
+    uint32_t        lodChangeTick;
+    PixelLayout     layout;
 };
 
 extern PixelController *gPixels;
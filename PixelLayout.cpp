@@ -0,0 +1,79 @@
+//
+//  PixelLayout.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PixelLayout.h"
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+
+PixelLayout::PixelLayout() {
+    segmentCount = 0;
+    pitch = 1.0;
+}
+
+bool PixelLayout::load(const char *path) {
+    File                    file = LittleFS.open(path, "r");
+
+    segmentCount = 0;
+    if (!file) {
+        return false;
+    }
+
+    DynamicJsonDocument     jsonDoc(file.size() * 2 + 256);
+    DeserializationError    error = deserializeJson(jsonDoc, file);
+
+    file.close();
+    if (error) {
+        Serial.print(F("Layout load failed: "));
+        Serial.println(error.f_str());
+        return false;
+    }
+
+    pitch = jsonDoc["pitch"] | 1.0f;
+    if (pitch <= 0.0) {
+        pitch = 1.0;
+    }
+
+    for (JsonObjectConst seg : jsonDoc["segments"].as<JsonArrayConst>()) {
+        SegmentPtr  segP = &segments[segmentCount];
+
+        if (segmentCount >= kLAYOUT_MAX_SEGS) {
+            Serial.println(F("Too many layout segments"));
+            break;
+        }
+
+        segP->first = seg["first"] | 0;
+        segP->count = seg["count"] | 0;
+        segP->x0 = seg["from"][0] | 0.0f;
+        segP->y0 = seg["from"][1] | 0.0f;
+        segP->x1 = seg["to"][0] | 0.0f;
+        segP->y1 = seg["to"][1] | 0.0f;
+
+        if (segP->count > 0) {
+            segmentCount++;
+        }
+    }
+
+    return segmentCount > 0;
+}
+
+bool PixelLayout::pointFor(uint16_t logicalIdx, float &x, float &y) {
+    SegmentPtr  segP = segments;
+
+    for (int sIdx=0; sIdx<segmentCount; sIdx++, segP++) {
+        if (logicalIdx >= segP->first && logicalIdx < segP->first + segP->count) {
+            float   t = segP->count > 1 ? (float)(logicalIdx - segP->first) / (float)(segP->count - 1) : 0.0f;
+
+            x = segP->x0 + (segP->x1 - segP->x0) * t;
+            y = segP->y0 + (segP->y1 - segP->y0) * t;
+
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,58 @@
+//
+//  PixelLayout.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PixelLayout_h
+#define PixelLayout_h
+
+#include <Arduino.h>
+
+// Optional physical placement of the pixels, loaded from a small JSON file.
+// The layout is a list of straight runs, each placing a range of logical
+// indexes evenly between two points (mm). A pitch gives the nominal spacing
+// between LEDs so positions can be expressed in "LEDs" like effect widths.
+//
+// {
+//   "pitch": 16.6,
+//   "segments": [
+//     { "first": 0, "count": 147, "from": [0, 0], "to": [2440, 0] },
+//     { "first": 149, "count": 71, "from": [2480, 40], "to": [2480, 1200] }
+//   ]
+// }
+//
+// Only the segments are kept. Coordinates are resolved when an area is
+// defined and turned into that area's position table (see PixelAreaRec).
+
+#define kLAYOUT_PATH        "/layout.json"
+#define kLAYOUT_MAX_SEGS    16
+#define kPOS_FRAC_BITS      6           // area positions are 10.6 fixed point LEDs
+#define kPOS_ONE            (1 << kPOS_FRAC_BITS)
+
+class PixelLayout {
+public:
+    PixelLayout();
+
+    bool load(const char *path);
+    bool pointFor(uint16_t logicalIdx, float &x, float &y);
+
+    inline bool isLoaded() { return segmentCount > 0; }
+    inline float getPitch() { return pitch; }
+
+private:
+    typedef struct {
+        uint16_t    first;
+        uint16_t    count;
+        float       x0, y0;
+        float       x1, y1;
+    } SegmentRec, *SegmentPtr;
+
+    SegmentRec  segments[kLAYOUT_MAX_SEGS];
+    uint8_t     segmentCount;
+    float       pitch;
+};
+
+#endif
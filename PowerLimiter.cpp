@@ -0,0 +1,54 @@
+//
+//  PowerLimiter.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PowerLimiter.h"
+#include "config.h"
+
+PowerLimiter::PowerLimiter() {
+    init(0, 0);
+}
+
+// The pixel buffer starts out zeroed so the sums do too
+
+void PowerLimiter::init(uint16_t numPixels, uint32_t budget) {
+    sumG = sumR = sumB = sumW = 0;
+    idleDraw = numPixels * kPOWER_IDLE_MA;
+    this->budget = budget;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.scale = kPOWER_SCALE_ONE;
+}
+
+uint16_t PowerLimiter::frameScale() {
+    uint32_t    channelDraw;
+    uint16_t    scale = kPOWER_SCALE_ONE;
+
+    channelDraw = ((uint32_t)sumG * kPOWER_MA_G + (uint32_t)sumR * kPOWER_MA_R +
+                   (uint32_t)sumB * kPOWER_MA_B + (uint32_t)sumW * kPOWER_MA_W) / 255;
+
+    stats.estimate = idleDraw + channelDraw;
+    if (stats.estimate > stats.peak) {
+        stats.peak = stats.estimate;
+    }
+
+    // Only the channel draw scales, the quiescent draw is there regardless.
+    // Output values are truncated when scaled so the result stays under budget.
+    if (budget != 0 && stats.estimate > budget && channelDraw > 0) {
+        uint32_t    available = budget > idleDraw ? budget - idleDraw : 0;
+
+        scale = (available * kPOWER_SCALE_ONE) / channelDraw;
+
+        if (stats.scale == kPOWER_SCALE_ONE) {
+            stats.limitEvents++;
+        }
+        stats.limitedFrames++;
+    }
+    stats.scale = scale;
+
+    return scale;
+}
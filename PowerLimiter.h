@@ -0,0 +1,62 @@
+//
+//  PowerLimiter.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PowerLimiter_h
+#define PowerLimiter_h
+
+#include "ColorUtils.h"
+
+// Both strips run off one supply, so the output stage estimates the current a
+// frame will draw and scales the whole frame down when it would exceed the
+// budget. Channel sums are kept up to date as pixels are written (see
+// PixelController::setPixel) so the per frame cost is a handful of multiplies
+// no matter how many pixels there are. The scale is applied as the pixels are
+// shifted out (espShow) so the pixel buffer itself is never modified.
+//
+// The estimate assumes GRBW chips. 3-byte strips, which fold white into RGB,
+// will be slightly underestimated when white is in use.
+
+#define kPOWER_SCALE_ONE        256         // 8.8 fixed point, i.e. no scaling
+
+typedef struct {
+    uint32_t    estimate;       // mA, last frame before limiting
+    uint32_t    peak;           // mA, highest estimate seen
+    uint32_t    limitedFrames;  // frames that were scaled
+    uint32_t    limitEvents;    // times we went from unscaled to scaled
+    uint16_t    scale;          // last applied, kPOWER_SCALE_ONE when unscaled
+} PowerStatsRec, *PowerStatsPtr;
+
+class PowerLimiter {
+public:
+    PowerLimiter();
+
+    void init(uint16_t numPixels, uint32_t budget);
+
+    inline void replace(SPixelRec oldPixel, SPixelRec newPixel) {
+        sumG += (int32_t)newPixel.comp.g - oldPixel.comp.g;
+        sumR += (int32_t)newPixel.comp.r - oldPixel.comp.r;
+        sumB += (int32_t)newPixel.comp.b - oldPixel.comp.b;
+        sumW += (int32_t)newPixel.comp.w - oldPixel.comp.w;
+    }
+
+    uint16_t frameScale();
+
+    inline uint32_t getBudget() { return budget; }
+    inline const PowerStatsRec &getStats() { return stats; }
+
+private:
+    int32_t         sumG;
+    int32_t         sumR;
+    int32_t         sumB;
+    int32_t         sumW;
+    uint32_t        idleDraw;
+    uint32_t        budget;
+    PowerStatsRec   stats;
+};
+
+#endif
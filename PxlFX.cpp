@@ -7,17 +7,52 @@
 //
 
 #include "PxlFX.h"
+#include "PxlFXRender.h"
 
 PxlFX::PxlFX(PixelController *inController) {
     controller = inController;
     area = nullptr;
     startTick = inController->getTick();
+    detail = 1;
 }
 
 void PxlFX::setArea(PixelAreaRec *inArea) {
     area = inArea;
 }
 
+// For positional effects: each pixel's position within a repeating pattern
+// width LEDs wide, as a fraction of a turn (0 - 65535). Callers own the table.
+
+uint16_t *PxlFX::buildPhases(float width) {
+    uint16_t    *phases = nullptr;
+
+    if (area->pos != nullptr && width > 0.0 && (phases = (uint16_t *)malloc(sizeof(uint16_t) * area->len)) != NULL) {
+        for (int i=0; i<area->len; i++) {
+            float   turns = (float)area->pos[i] / (float)kPOS_ONE / width;
+
+            phases[i] = (turns - floorf(turns)) * 65536.0f;
+        }
+    }
+
+    return phases;
+}
+
+// Effects running at reduced detail compute every detail'th pixel of the area
+// and call this to blend the ones in between (the tail repeats the last one).
+
+void PxlFX::fillSkipped() {
+    uint16_t    *map = area->map;
+
+    for (int i=0; i<area->len; i+=detail) {
+        SPixelRec   from = controller->getPixel(map[i]);
+        SPixelRec   to = i + detail < area->len ? controller->getPixel(map[i + detail]) : from;
+
+        for (int j=1; j<detail && i + j<area->len; j++) {
+            controller->setPixel(map[i + j], ColorUtils::blend(from, to, (j * 256) / detail));
+        }
+    }
+}
+
 bool PxlFX::update() {
     bool finished = true;
 
@@ -41,8 +76,8 @@ PxlFX_Transition::PxlFX_Transition(PixelController *inController, SHSVRec inFrom
 }
 
 bool PxlFX_Transition::safeUpdate() {
-    SPixelRec   pixel;
-    uint16_t    *mapIdx = area->map;
+    FillKernel  fill;
+    SPixelRec   &pixel = fill.pixel;
     bool        complete = false;
 
     if (duration > 0.0) {
@@ -57,9 +92,7 @@ bool PxlFX_Transition::safeUpdate() {
         complete = true;
     }
 
-    for (int i=0; i<area->len; i++, mapIdx++) {
-        controller->setPixel(*mapIdx, pixel);
-    }
+    renderPass(controller, area, fill);
 
     return complete;
 }
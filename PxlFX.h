@@ -12,19 +12,40 @@
 #include "ColorUtils.h"
 #include "PixelController.h"
 
+// Lookup sizes for effects running in positional mode
+#define kVALUE_RAMP_LEN     65      // val 0 - 1 in 1/64ths
+#define kHUE_RAMP_LEN       256
+
+// Slow moving effects render a keyframe every kKEYFRAME_INTERVAL ticks and the
+// output in between is interpolated (see PixelController::renderArea). An RGB
+// blend only stands in for the real thing when neighbouring keyframes are
+// close, so anything moving more than kKEYFRAME_MAX_STEP of its cycle per tick
+// renders every tick instead.
+#define kKEYFRAME_INTERVAL  2
+#define kKEYFRAME_MAX_STEP  (1.0f / 120.0f)     // 3 degrees of hue per tick
+
 class PxlFX {
 public:
     PxlFX(PixelController *inController);
+    virtual ~PxlFX() { }
 
     virtual void setArea(PixelAreaRec *inArea);
+    virtual uint8_t keyframeInterval() { return 1; }   // ticks per rendered frame
+    virtual bool holdsWhenComplete() { return false; }  // the final frame is the area's steady state (keep its spec)
+    inline void setDetail(uint8_t step) { detail = step; }
 
     bool update();
     virtual bool safeUpdate() = 0;  // return true upon completion
 
 protected:
+    static inline uint8_t keyframesFor(float cyclesPerTick) { return fabsf(cyclesPerTick) <= kKEYFRAME_MAX_STEP ? kKEYFRAME_INTERVAL : 1; }
+    uint16_t *buildPhases(float width);
+    void fillSkipped();
+
     PixelController *controller;
     PixelAreaRec    *area;
     uint32_t        startTick;
+    uint8_t         detail;         // under load, only every detail'th pixel is computed
 };
 
 class PxlFX_Transition : public PxlFX {
@@ -0,0 +1,63 @@
+//
+//  PxlFXRender.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PxlFXRender_h
+#define PxlFXRender_h
+
+#include "PixelController.h"
+
+// Effects describe a frame as a small kernel: a functor returning the pixel
+// for each area index, called in order. renderPass runs the kernel over the
+// area with a loop instantiated per kernel and per kind of area map, so the
+// kernel, the map lookup and setPixel all inline into one tight loop with no
+// virtual or cross file calls per pixel. Areas that are one contiguous run
+// (forward or reversed) don't even need to read their map.
+//
+// struct FooKernel {
+//     inline SPixelRec operator()(uint16_t idx) { ... }
+// };
+
+struct MapContiguous {
+    static inline uint16_t pixelIndex(const PixelAreaRec *area, uint16_t idx) { return area->mapFirst + idx; }
+};
+
+struct MapReversed {
+    static inline uint16_t pixelIndex(const PixelAreaRec *area, uint16_t idx) { return area->mapFirst - idx; }
+};
+
+struct MapSegmented {
+    static inline uint16_t pixelIndex(const PixelAreaRec *area, uint16_t idx) { return area->map[idx]; }
+};
+
+template <class Map, class Kernel>
+inline void renderLoop(PixelController *controller, const PixelAreaRec *area, Kernel &kernel, uint16_t count, uint8_t step) {
+    for (uint16_t idx=0; idx<count; idx+=step) {
+        controller->setPixel(Map::pixelIndex(area, idx), kernel(idx));
+    }
+}
+
+// step > 1 only computes every step'th pixel (see PxlFX::fillSkipped)
+
+template <class Kernel>
+inline void renderPass(PixelController *controller, const PixelAreaRec *area, Kernel &kernel, uint8_t step = 1, int16_t count = -1) {
+    uint16_t    len = count < 0 ? area->len : count;
+
+    switch (area->mapKind) {
+        case map_contiguous:    renderLoop<MapContiguous>(controller, area, kernel, len, step); break;
+        case map_reversed:      renderLoop<MapReversed>(controller, area, kernel, len, step); break;
+        default:                renderLoop<MapSegmented>(controller, area, kernel, len, step); break;
+    }
+}
+
+struct FillKernel {
+    SPixelRec   pixel;
+
+    inline SPixelRec operator()(uint16_t idx) { return pixel; }
+};
+
+#endif
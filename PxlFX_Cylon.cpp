@@ -7,18 +7,56 @@
 //
 
 #include "PxlFX_Cylon.h"
+#include "PxlFXRender.h"
 
-PxlFX_Cylon::PxlFX_Cylon(PixelController *inController, float inRate, float inWidth, float inDur) : PxlFX(inController) {
+namespace {
+
+struct CylonKernel {
+    SHSVRec     color;
+    float       cur;
+    float       halfWidth;
+
+    inline SPixelRec operator()(uint16_t idx) {
+        SPixelRec   pixel;
+        float       dist = fabs(((float)idx + 0.5f) - cur);
+
+        if (dist < halfWidth) {
+            pixel = ColorUtils::HSVtoPixel(color.withVal(color.val * (halfWidth - dist) / halfWidth));
+        }
+        else {
+            pixel.rgbw = 0;
+        }
+
+        return pixel;
+    }
+};
+
+struct CylonPositionalKernel {
+    const SPixelRec *ramp;
+    const uint16_t  *pos;
+    uint32_t        cur;
+    uint32_t        halfPos;
+    uint32_t        recip;
+
+    inline SPixelRec operator()(uint16_t idx) {
+        uint32_t    dist = pos[idx] > cur ? pos[idx] - cur : cur - pos[idx];
+
+        return ramp[dist < halfPos ? ((halfPos - dist) * recip) >> 16 : 0];
+    }
+};
+
+}
+
+PxlFX_Cylon::PxlFX_Cylon(PixelController *inController, float inRate, float inWidth, float inDur, uint8_t inFlags) : PxlFX(inController) {
     rate = inRate;
     halfWidth = inWidth / 2.0;
     duration = inDur;
+    flags = inFlags;
+    ramp = nullptr;
 }
 
-PxlFX_Cylon::PxlFX_Cylon(PixelController *inController, const JsonDocument &json) : PxlFX(inController) {
-    rate = json["rate"];
-    halfWidth = json["width"];
-    halfWidth /= 2.0f;
-    duration = 0.0;
+PxlFX_Cylon::~PxlFX_Cylon() {
+    free(ramp);
 }
 
 void PxlFX_Cylon::setArea(PixelAreaRec *inArea) {
@@ -29,48 +67,29 @@ void PxlFX_Cylon::setArea(PixelAreaRec *inArea) {
     // doesn't look quite how I wanted.
     start = 0;
     end = inArea->len;
-    cur = start;
-    inc = ((end - start) * 2.0) / rate * controller->tickRate();    // complete cycle from start to end to start @ rate
-    forward = true;
+
+    if ((flags & fx_flag_positional) && inArea->pos != nullptr && (ramp = (SPixelRec *)malloc(sizeof(SPixelRec) * kVALUE_RAMP_LEN)) != NULL) {
+        ColorUtils::valueRamp(baseColor, ramp, kVALUE_RAMP_LEN);
+    }
 }
 
 bool PxlFX_Cylon::safeUpdate() {
     bool        complete = true;
 
-    if (rate != 0.0 && halfWidth > 0.0) {
-        SHSVRec     color = baseColor;
-        SPixelRec   offPixel;
-        uint16_t    *mapIdx = area->map;
-        float       baseVal = color.val;
-        float       dist;
-        float       unused; // NULL?
-
-        offPixel.rgbw = 0;
-        for (int i=0; i<area->len; i++, mapIdx++) {
-            dist = fabs(((float)i + 0.5f) - cur);
-            if (dist < halfWidth) {
-                float       mult = (halfWidth - dist) / halfWidth;
-
-                controller->setPixel(*mapIdx, ColorUtils::HSVtoPixel(color.withVal(baseVal * mult)));
-            }
-            else {
-                controller->setPixel(*mapIdx, offPixel);
-            }
-        }
+    if (rate != 0.0 && halfWidth > 0.0 && ramp != nullptr) {
+        float       phase = controller->framePhase(rate) * 2.0;
 
-        if (forward) {
-            cur += inc;
-            if (cur >= end) {
-                cur -= cur - end;
-                forward = false;
-            }
-        }
-        else {
-            cur -= inc;
-            if (cur <= start) {
-                cur += start - cur;
-                forward = true;
-            }
+        updatePositional(phase < 1.0 ? phase : 2.0 - phase);
+        complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
+    }
+    else if (rate != 0.0 && halfWidth > 0.0) {
+        float       phase = controller->framePhase(rate) * 2.0;       // complete cycle from start to end to start @ rate
+        float       cur = phase < 1.0 ? start + phase * (end - start) : end - (phase - 1.0) * (end - start);
+        CylonKernel kernel = { baseColor, cur, halfWidth };
+
+        renderPass(controller, area, kernel, detail);
+        if (detail > 1) {
+            fillSkipped();
         }
 
         complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
@@ -78,3 +97,13 @@ bool PxlFX_Cylon::safeUpdate() {
 
     return complete;
 }
+
+// The eye travels the area's physical span; distances are in the area's 10.6
+// fixed point positions and the falloff comes from a precomputed ramp.
+
+void PxlFX_Cylon::updatePositional(float travel) {
+    uint32_t                halfPos = max(1.0f, halfWidth * kPOS_ONE);
+    CylonPositionalKernel   kernel = { ramp, area->pos, (uint32_t)(travel * area->span), halfPos, ((kVALUE_RAMP_LEN - 1) << 16) / halfPos };
+
+    renderPass(controller, area, kernel);
+}
@@ -13,19 +13,20 @@
 
 class PxlFX_Cylon : public PxlFX {
 public:
-    PxlFX_Cylon(PixelController *inController, float inRate, float inWidth, float inDur=0.0);
-    PxlFX_Cylon(PixelController *inController, const JsonDocument &json);
+    PxlFX_Cylon(PixelController *inController, float inRate, float inWidth, float inDur=0.0, uint8_t inFlags=0);
+    ~PxlFX_Cylon();
     
     void setArea(PixelAreaRec *inArea);
     bool safeUpdate();
 
 private:
+    void updatePositional(float phase);
+
     SHSVRec     baseColor;
+    uint8_t     flags;
+    SPixelRec   *ramp;          // positional mode only
     float       start;
     float       end;
-    float       cur;
-    float       inc;
-    bool        forward;
     float       rate;           // how long for pattern to move through a point
     float       halfWidth;      // how many LEDs wide ( / 2)
     float       duration;
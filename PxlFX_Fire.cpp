@@ -0,0 +1,89 @@
+//
+//  PxlFX_Fire.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PxlFX_Fire.h"
+#include "PxlFXRender.h"
+#include "Noise.h"
+
+#define kFIRE_PALETTE_LEN   256
+
+namespace {
+
+template <bool Positional>
+struct FireKernel {
+    const SPixelRec *palette;
+    const uint16_t  *pos;
+    uint16_t        xStep;          // noise units per LED
+    uint16_t        t;
+
+    inline SPixelRec operator()(uint16_t idx) {
+        uint16_t    x = Positional ? ((uint32_t)pos[idx] * xStep) >> kPOS_FRAC_BITS : idx * xStep;
+
+        return palette[Noise::fractal2(x, t, 2)];
+    }
+};
+
+}
+
+PxlFX_Fire::PxlFX_Fire(PixelController *inController, float inRate, float inWidth, float inDur, uint8_t inFlags) : PxlFX(inController) {
+    rate = inRate;
+    width = inWidth;
+    duration = inDur;
+    flags = inFlags;
+    palette = nullptr;
+}
+
+PxlFX_Fire::~PxlFX_Fire() {
+    free(palette);
+}
+
+// The bottom of the heat range stays dark so the flames break up
+
+void PxlFX_Fire::setArea(PixelAreaRec *inArea) {
+    float   baseVal = inArea->baseColor.clamped().val;
+
+    PxlFX::setArea(inArea);
+
+    if ((palette = (SPixelRec *)malloc(sizeof(SPixelRec) * kFIRE_PALETTE_LEN)) != NULL) {
+        for (uint16_t i=0; i<kFIRE_PALETTE_LEN; i++) {
+            float   heat = (float)i / (float)(kFIRE_PALETTE_LEN - 1);
+            float   hue = min(60.0f, heat * heat * 90.0f);
+            float   sat = heat > 0.85f ? 1.0f - (heat - 0.85f) * 3.0f : 1.0f;
+            float   val = min(1.0f, max(0.0f, (heat - 0.25f) * 2.0f));
+
+            palette[i] = ColorUtils::HSVtoPixel(SHSVRec(hue, sat, val * baseVal));
+        }
+    }
+}
+
+bool PxlFX_Fire::safeUpdate() {
+    bool        complete = true;
+
+    if (rate != 0.0 && width > 0.0 && palette != nullptr) {
+        uint16_t    xStep = max(1.0f, 256.0f / width);
+        uint16_t    t = controller->framePhase(256.0 / rate) * 65536.0f;     // all 256 cells every 256 / rate seconds
+
+        if ((flags & fx_flag_positional) && area->pos != nullptr) {
+            FireKernel<true>    kernel = { palette, area->pos, xStep, t };
+
+            renderPass(controller, area, kernel);
+        }
+        else {
+            FireKernel<false>   kernel = { palette, nullptr, xStep, t };
+
+            renderPass(controller, area, kernel, detail);
+            if (detail > 1) {
+                fillSkipped();
+            }
+        }
+
+        complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
+    }
+
+    return complete;
+}
@@ -0,0 +1,33 @@
+//
+//  PxlFX_Fire.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PxlFX_Fire_h
+#define PxlFX_Fire_h
+
+#include "PxlFX.h"
+
+// Flickering fire: two octaves of noise, drifting at rate lattice cells per second,
+// mapped through a black - red - yellow - white heat palette built in setArea.
+
+class PxlFX_Fire : public PxlFX {
+public:
+    PxlFX_Fire(PixelController *inController, float inRate, float inWidth, float inDur=0.0, uint8_t inFlags=0);
+    ~PxlFX_Fire();
+    
+    void setArea(PixelAreaRec *inArea);
+    bool safeUpdate();
+
+private:
+    uint8_t     flags;
+    SPixelRec   *palette;
+    float       rate;           // lattice cells per second
+    float       width;          // how many LEDs per lattice cell
+    float       duration;
+};
+
+#endif
@@ -0,0 +1,117 @@
+//
+//  PxlFX_Gradient.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PxlFX_Gradient.h"
+#include "PxlFXRender.h"
+
+namespace {
+
+template <bool Positional, bool Breathe>
+struct GradientKernel {
+    const SPixelRec *lut;
+    const uint16_t  *pos;
+    uint16_t        lutLen;
+    uint16_t        offset;
+    int32_t         weight;         // breathe: 0 - 256
+
+    inline SPixelRec operator()(uint16_t idx) {
+        uint16_t    where = Positional ? pos[idx] >> kPOS_FRAC_BITS : idx;
+        SPixelRec   pixel = lut[(where + offset) % lutLen];
+
+        if (Breathe) {
+            SPixelRec   black;
+
+            black.rgbw = 0;
+            pixel = ColorUtils::blend(black, pixel, weight);
+        }
+
+        return pixel;
+    }
+};
+
+template <bool Positional>
+void renderGradient(PixelController *controller, PixelAreaRec *area, const SPixelRec *lut, uint16_t lutLen, uint16_t offset, int32_t weight) {
+    if (weight < 256) {
+        GradientKernel<Positional, true>    kernel = { lut, area->pos, lutLen, offset, weight };
+
+        renderPass(controller, area, kernel);
+    }
+    else {
+        GradientKernel<Positional, false>   kernel = { lut, area->pos, lutLen, offset, weight };
+
+        renderPass(controller, area, kernel);
+    }
+}
+
+}
+
+PxlFX_Gradient::PxlFX_Gradient(PixelController *inController, const FXStopsRec &inStops, float inRate, float inWidth, float inDur, uint8_t inFlags) : PxlFX(inController) {
+    stops = inStops;
+    rate = inRate;
+    width = inWidth;
+    duration = inDur;
+    flags = inFlags;
+    lut = nullptr;
+    lutLen = 0;
+}
+
+PxlFX_Gradient::~PxlFX_Gradient() {
+    free(lut);
+}
+
+// Scrolling wraps so its table blends the last stop back into the first. With
+// no stops it falls back to the area's color.
+
+void PxlFX_Gradient::setArea(PixelAreaRec *inArea) {
+    SHSVRec     colors[kFX_MAX_STOPS];
+    uint8_t     colorCount = max((uint8_t)1, stops.count);
+    bool        positional = (flags & fx_flag_positional) && inArea->pos != nullptr;
+    uint16_t    areaLen = positional ? (inArea->span >> kPOS_FRAC_BITS) + 1 : inArea->len;
+
+    PxlFX::setArea(inArea);
+
+    colors[0] = inArea->baseColor.clamped();
+    for (uint8_t i=0; i<stops.count; i++) {
+        colors[i] = SHSVRec(stops.stops[i].hue, stops.stops[i].sat / 100.0f, stops.stops[i].val / 100.0f);
+    }
+
+    lutLen = min((uint16_t)kGRADIENT_MAX_LUT, (uint16_t)(width >= 1.0 ? width : areaLen));
+    if ((lut = (SPixelRec *)malloc(sizeof(SPixelRec) * lutLen)) != NULL) {
+        ColorUtils::gradientRamp(colors, colorCount, rate != 0.0 && !(flags & fx_flag_breathe), lut, lutLen);
+    }
+}
+
+bool PxlFX_Gradient::safeUpdate() {
+    bool        complete = true;
+
+    if (lut != nullptr) {
+        uint16_t    offset = 0;
+        int32_t     weight = 256;
+
+        if (rate != 0.0 && (flags & fx_flag_breathe)) {
+            float   phase = controller->framePhase(rate) * 2.0;
+
+            weight = 64 + (int32_t)((phase < 1.0 ? phase : 2.0 - phase) * 192.0f);      // 25% - 100%
+        }
+        else if (rate != 0.0) {
+            offset = controller->framePhase(rate) * lutLen;
+        }
+
+        if ((flags & fx_flag_positional) && area->pos != nullptr) {
+            renderGradient<true>(controller, area, lut, lutLen, offset, weight);
+        }
+        else {
+            renderGradient<false>(controller, area, lut, lutLen, offset, weight);
+        }
+
+        // a static gradient only needs drawing once
+        complete = rate == 0.0 || (duration > 0.0 ? controller->tickTime(startTick) > duration : false);
+    }
+
+    return complete;
+}
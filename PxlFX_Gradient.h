@@ -0,0 +1,41 @@
+//
+//  PxlFX_Gradient.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PxlFX_Gradient_h
+#define PxlFX_Gradient_h
+
+#include "PxlFX.h"
+
+// A gradient through up to kFX_MAX_STOPS colors, computed once into a pixel
+// table in setArea. With a rate it either scrolls along the area (a full
+// length every rate seconds) or, with fx_flag_breathe, pulses in brightness;
+// both just change how the table is read. Without a rate it draws once.
+
+#define kGRADIENT_MAX_LUT   512
+
+class PxlFX_Gradient : public PxlFX {
+public:
+    PxlFX_Gradient(PixelController *inController, const FXStopsRec &inStops, float inRate, float inWidth, float inDur=0.0, uint8_t inFlags=0);
+    ~PxlFX_Gradient();
+
+    void setArea(PixelAreaRec *inArea);
+    uint8_t keyframeInterval() { return (flags & fx_flag_breathe) ? kKEYFRAME_INTERVAL : keyframesFor(PixelController::tickRate() / rate); }   // breathing blends exactly
+    bool holdsWhenComplete() { return rate == 0.0; }   // static, drawn once
+    bool safeUpdate();
+
+private:
+    FXStopsRec  stops;
+    uint8_t     flags;
+    SPixelRec   *lut;
+    uint16_t    lutLen;
+    float       rate;           // seconds per scroll or breath
+    float       width;          // how many LEDs wide, 0 for the whole area
+    float       duration;
+};
+
+#endif
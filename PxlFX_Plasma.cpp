@@ -0,0 +1,82 @@
+//
+//  PxlFX_Plasma.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PxlFX_Plasma.h"
+#include "PxlFXRender.h"
+#include "Noise.h"
+
+namespace {
+
+// The second layer is twice the size, offset so the two don't line up, and
+// the palette index runs through the hue ramp about twice
+
+template <bool Positional>
+struct PlasmaKernel {
+    const SPixelRec *palette;
+    const uint16_t  *pos;
+    uint16_t        xStep;          // noise units per LED
+    uint16_t        t;
+
+    inline SPixelRec operator()(uint16_t idx) {
+        uint16_t    x = Positional ? ((uint32_t)pos[idx] * xStep) >> kPOS_FRAC_BITS : idx * xStep;
+        uint16_t    sum = Noise::noise2(x, t) + Noise::noise2((x >> 1) + 0x8000, (t >> 1) + 0x4000);
+
+        return palette[(uint8_t)(sum + (t >> 6))];
+    }
+};
+
+}
+
+PxlFX_Plasma::PxlFX_Plasma(PixelController *inController, float inRate, float inWidth, float inDur, uint8_t inFlags) : PxlFX(inController) {
+    rate = inRate;
+    width = inWidth;
+    duration = inDur;
+    flags = inFlags;
+    palette = nullptr;
+}
+
+PxlFX_Plasma::~PxlFX_Plasma() {
+    free(palette);
+}
+
+void PxlFX_Plasma::setArea(PixelAreaRec *inArea) {
+    SHSVRec     baseColor = inArea->baseColor.clamped();
+
+    PxlFX::setArea(inArea);
+
+    if ((palette = (SPixelRec *)malloc(sizeof(SPixelRec) * kHUE_RAMP_LEN)) != NULL) {
+        ColorUtils::hueRamp(baseColor.hue, 1.0, baseColor.val, palette, kHUE_RAMP_LEN);
+    }
+}
+
+bool PxlFX_Plasma::safeUpdate() {
+    bool        complete = true;
+
+    if (rate != 0.0 && width > 0.0 && palette != nullptr) {
+        uint16_t    xStep = max(1.0f, 256.0f / width);
+        uint16_t    t = controller->framePhase(256.0 / rate) * 65536.0f;     // all 256 cells every 256 / rate seconds
+
+        if ((flags & fx_flag_positional) && area->pos != nullptr) {
+            PlasmaKernel<true>  kernel = { palette, area->pos, xStep, t };
+
+            renderPass(controller, area, kernel);
+        }
+        else {
+            PlasmaKernel<false> kernel = { palette, nullptr, xStep, t };
+
+            renderPass(controller, area, kernel, detail);
+            if (detail > 1) {
+                fillSkipped();
+            }
+        }
+
+        complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
+    }
+
+    return complete;
+}
@@ -0,0 +1,34 @@
+//
+//  PxlFX_Plasma.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PxlFX_Plasma_h
+#define PxlFX_Plasma_h
+
+#include "PxlFX.h"
+
+// Slowly churning plasma: two layers of noise, drifting at rate lattice cells per
+// second, index a hue palette starting at the area's color built in setArea.
+
+class PxlFX_Plasma : public PxlFX {
+public:
+    PxlFX_Plasma(PixelController *inController, float inRate, float inWidth, float inDur=0.0, uint8_t inFlags=0);
+    ~PxlFX_Plasma();
+    
+    void setArea(PixelAreaRec *inArea);
+    uint8_t keyframeInterval() { return kKEYFRAME_INTERVAL; }
+    bool safeUpdate();
+
+private:
+    uint8_t     flags;
+    SPixelRec   *palette;
+    float       rate;           // lattice cells per second
+    float       width;          // how many LEDs per lattice cell
+    float       duration;
+};
+
+#endif
@@ -0,0 +1,198 @@
+//
+//  PxlFX_Playback.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PxlFX_Playback.h"
+#include "PxlFXRender.h"
+
+namespace {
+
+struct FrameKernel {
+    const SPixelRec *frame;
+
+    inline SPixelRec operator()(uint16_t idx) { return frame[idx]; }
+};
+
+}
+
+PxlFX_Playback::PxlFX_Playback(PixelController *inController, const char *inPath, float inDur) : PxlFX(inController) {
+    strlcpy(path, inPath, sizeof(path));
+    duration = inDur;
+    frame = nullptr;
+    frameIdx = 0;
+    lastFrameTick = 0;
+    readPos = 0;
+    readLen = 0;
+    decodeTime = 0;
+    readTime = 0;
+    readBytesTotal = 0;
+    maxDecodeTime = 0;
+}
+
+PxlFX_Playback::~PxlFX_Playback() {
+    if (file) {
+        file.close();
+    }
+    free(frame);
+}
+
+void PxlFX_Playback::setArea(PixelAreaRec *inArea) {
+    PxlFX::setArea(inArea);
+
+    file = LittleFS.open(path, "r");
+    if (file && file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+        header.magic == kFRAME_MAGIC && header.version == kFRAME_VERSION && header.frameCount > 0) {
+        frame = (SPixelPtr)malloc(header.pixelCount * sizeof(SPixelRec));
+    }
+
+    if (frame == nullptr) {
+        Serial.print(F("Playback: unable to play ")); Serial.println(path);
+        if (file) {
+            file.close();
+        }
+        return;
+    }
+
+    rewind();
+}
+
+bool PxlFX_Playback::rewind() {
+    memset(frame, 0, header.pixelCount * sizeof(SPixelRec));
+    frameIdx = 0;
+    readPos = 0;
+    readLen = 0;
+    lastFrameTick = controller->getTick() - header.frameTicks;   // first frame right away
+
+    return file.seek(sizeof(FrameHeaderRec), SeekSet);
+}
+
+bool PxlFX_Playback::safeUpdate() {
+    uint32_t    tick = controller->getTick();
+    bool        complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
+
+    if (frame == nullptr) {
+        return true;
+    }
+
+    if (tick - lastFrameTick >= header.frameTicks) {
+        FrameKernel kernel = { frame };
+        uint16_t    count = min((uint16_t)area->len, header.pixelCount);
+
+        lastFrameTick = tick;
+        if (frameIdx >= header.frameCount) {
+#if SHOW_PLAYBACK_STATS == 1
+            Serial.printf("Playback: %d frames, decode avg %dµS max %dµS, read %d bytes in %dµS (%d KB/s)\n",
+                frameIdx, decodeTime / frameIdx, maxDecodeTime, readBytesTotal, readTime,
+                readTime ? (uint32_t)((uint64_t)readBytesTotal * 1000000 / readTime / 1024) : 0);
+            decodeTime = readTime = readBytesTotal = maxDecodeTime = 0;
+#endif
+            rewind();
+        }
+
+        if (!decodeFrame()) {
+            return true;    // truncated or corrupt file
+        }
+
+        renderPass(controller, area, kernel, 1, count);
+    }
+
+    return complete;
+}
+
+bool PxlFX_Playback::decodeFrame() {
+    uint32_t    start = micros();
+    uint32_t    startReadTime = readTime;
+    uint16_t    frameLen;
+    uint16_t    consumed = 0;
+    uint16_t    idx = 0;
+    uint32_t    elapsed;
+
+    if (!readBytes(&frameLen, sizeof(frameLen))) {
+        return false;
+    }
+
+    while (consumed < frameLen) {
+        uint8_t     op;
+        uint16_t    count;
+
+        if (!readBytes(&op, 1)) {
+            return false;
+        }
+        consumed++;
+        count = (op & (kFRAME_OP_MAX - 1)) + 1;
+        if (idx + count > header.pixelCount) {
+            return false;
+        }
+
+        switch (op & ~(kFRAME_OP_MAX - 1)) {
+            case frame_op_skip:
+                break;
+
+            case frame_op_copy:
+                if (!readBytes(&frame[idx], count * sizeof(SPixelRec))) {
+                    return false;
+                }
+                consumed += count * sizeof(SPixelRec);
+                break;
+
+            case frame_op_run: {
+                SPixelRec   pixel;
+
+                if (!readBytes(&pixel, sizeof(pixel))) {
+                    return false;
+                }
+                consumed += sizeof(pixel);
+                for (uint16_t i=0; i<count; i++) {
+                    frame[idx + i] = pixel;
+                }
+                break;
+            }
+
+            default:
+                return false;
+        }
+        idx += count;
+    }
+    frameIdx++;
+
+    elapsed = (micros() - start) - (readTime - startReadTime);
+    decodeTime += elapsed;
+    maxDecodeTime = max(maxDecodeTime, elapsed);
+
+    return true;
+}
+
+// Copy from the read-ahead buffer, topping it up from the file as needed
+
+bool PxlFX_Playback::readBytes(void *dst, size_t len) {
+    uint8_t     *dstP = (uint8_t *)dst;
+
+    while (len > 0) {
+        size_t  count;
+
+        if (readPos >= readLen) {
+            uint32_t    start = micros();
+
+            readLen = file.read(readAhead, sizeof(readAhead));
+            readPos = 0;
+            readTime += micros() - start;
+            readBytesTotal += readLen;
+
+            if (readLen == 0) {
+                return false;
+            }
+        }
+
+        count = min(len, (size_t)(readLen - readPos));
+        memcpy(dstP, readAhead + readPos, count);
+        readPos += count;
+        dstP += count;
+        len -= count;
+    }
+
+    return true;
+}
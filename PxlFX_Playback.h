@@ -0,0 +1,54 @@
+//
+//  PxlFX_Playback.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PxlFX_Playback_h
+#define PxlFX_Playback_h
+
+#include "PxlFX.h"
+#include "FrameRecorder.h"
+
+// Streams a recorded frame file (see FrameRecorder.h) from LittleFS onto the
+// area. The file is read through a small fixed read-ahead buffer and decoded
+// into a frame buffer the size of the area, so memory use only depends on the
+// area length. Plays in a loop until duration (if any) elapses.
+
+#define kPLAYBACK_READ_AHEAD    512
+#define SHOW_PLAYBACK_STATS     0
+
+class PxlFX_Playback : public PxlFX {
+public:
+    PxlFX_Playback(PixelController *inController, const char *inPath, float inDur=0.0);
+    ~PxlFX_Playback();
+
+    void setArea(PixelAreaRec *inArea);
+    bool safeUpdate();
+
+private:
+    bool rewind();
+    bool decodeFrame();
+    bool readBytes(void *dst, size_t len);
+
+    char            path[kFX_PATH_LEN];
+    float           duration;
+    File            file;
+    FrameHeaderRec  header;
+    SPixelPtr       frame;
+    uint16_t        frameIdx;
+    uint32_t        lastFrameTick;
+    uint8_t         readAhead[kPLAYBACK_READ_AHEAD];
+    uint16_t        readPos;
+    uint16_t        readLen;
+
+    // stats
+    uint32_t        decodeTime;     // µS spent decoding, excluding reads
+    uint32_t        readTime;       // µS spent in File::read
+    uint32_t        readBytesTotal;
+    uint32_t        maxDecodeTime;
+};
+
+#endif
@@ -0,0 +1,37 @@
+//
+//  PxlFX_Progress.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PxlFX_Progress.h"
+#include "PxlFXRender.h"
+
+namespace {
+
+struct ProgressKernel {
+    SPixelRec   onPixel;
+    SPixelRec   offPixel;
+    int         lastLit;
+
+    inline SPixelRec operator()(uint16_t idx) { return idx < lastLit ? onPixel : offPixel; }
+};
+
+}
+
+PxlFX_Progress::PxlFX_Progress(PixelController *inController, SHSVRec inColor, const float *inProgress) : PxlFX(inController) {
+    onPixel = ColorUtils::HSVtoPixel(inColor);
+    offPixel = ColorUtils::HSVtoPixel(inColor.withVal(inColor.val * 0.1));
+    progress = inProgress;
+}
+
+bool PxlFX_Progress::safeUpdate() {
+    float           curProgress = *progress;
+    ProgressKernel  kernel = { onPixel, offPixel, (int)(min(1.0f, curProgress) * area->len + 0.5f) };
+
+    renderPass(controller, area, kernel);
+
+    return false;
+}
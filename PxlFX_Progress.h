@@ -0,0 +1,29 @@
+//
+//  PxlFX_Progress.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PxlFX_Progress_h
+#define PxlFX_Progress_h
+
+#include "PxlFX.h"
+
+// Fills the area from left to right according to an externally owned progress
+// value (0 - 1). The owner must outlive the effect or remove it first.
+
+class PxlFX_Progress : public PxlFX {
+public:
+    PxlFX_Progress(PixelController *inController, SHSVRec inColor, const float *inProgress);
+
+    bool safeUpdate();
+
+private:
+    SPixelRec   onPixel;
+    SPixelRec   offPixel;
+    const float *progress;
+};
+
+#endif
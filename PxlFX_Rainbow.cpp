@@ -7,47 +7,80 @@
 //
 
 #include "PxlFX_Rainbow.h"
+#include "PxlFXRender.h"
 
-PxlFX_Rainbow::PxlFX_Rainbow(PixelController *inController, float inRate, float inWidth, float inDur) : PxlFX(inController) {
+namespace {
+
+struct RainbowKernel {
+    SHSVRec     color;
+    float       sweepInc;
+
+    inline SPixelRec operator()(uint16_t idx) {
+        SPixelRec   pixel = ColorUtils::HSVtoPixel(color);
+
+        color.hue += sweepInc;
+        if (color.hue >= 360.0) {
+            color.hue -= 360.0;
+        }
+        else if (color.hue < 0) {
+            color.hue += 360.0;
+        }
+
+        return pixel;
+    }
+};
+
+struct RainbowPositionalKernel {
+    const SPixelRec *ramp;
+    const uint16_t  *phases;
+    uint16_t        offset;
+
+    inline SPixelRec operator()(uint16_t idx) { return ramp[(uint16_t)(offset + phases[idx]) >> 8]; }
+};
+
+}
+
+PxlFX_Rainbow::PxlFX_Rainbow(PixelController *inController, float inRate, float inWidth, float inDur, uint8_t inFlags) : PxlFX(inController) {
     rate = inRate;
     width = inWidth;
     duration = inDur;
-    startAngle = 0.0;
+    flags = inFlags;
+    phases = nullptr;
+    ramp = nullptr;
 }
 
-PxlFX_Rainbow::PxlFX_Rainbow(PixelController *inController, const JsonDocument &json) : PxlFX(inController) {
-    rate = json["rate"];
-    width = json["width"];
-    duration = 0.0;
-    startAngle = 0.0;
+PxlFX_Rainbow::~PxlFX_Rainbow() {
+    free(phases);
+    free(ramp);
 }
 
-bool PxlFX_Rainbow::safeUpdate() {
-    bool        complete = true;
+void PxlFX_Rainbow::setArea(PixelAreaRec *inArea) {
+    PxlFX::setArea(inArea);
 
-    if (rate != 0.0 && width > 0.0) {
-        SHSVRec     color(startAngle, 1.0, 1.0);
-        float       sweepInc = 360.0 / width;
-        uint16_t    *mapIdx = area->map;
-
-        for (int i=0; i<area->len; i++, mapIdx++) {
-            controller->setPixel(*mapIdx, ColorUtils::HSVtoPixel(color));
-
-            color.hue += sweepInc;
-            if (color.hue >= 360.0) {
-                color.hue -= 360.0;
-            }
-            else if (color.hue < 0) {
-                color.hue += 360.0;
-            }
+    if ((flags & fx_flag_positional) && (phases = buildPhases(width)) != nullptr) {
+        if ((ramp = (SPixelRec *)malloc(sizeof(SPixelRec) * kHUE_RAMP_LEN)) != NULL) {
+            ColorUtils::hueRamp(0.0, 1.0, 1.0, ramp, kHUE_RAMP_LEN);
         }
-        
-        startAngle += (360.0 / rate) * controller->tickRate();
-        if (startAngle >= 360.0) {
-            startAngle -= 360.0;
+        else {
+            free(phases);
+            phases = nullptr;
         }
-        else if (startAngle < 0.0) {
-            startAngle += 360.0;
+    }
+}
+
+bool PxlFX_Rainbow::safeUpdate() {
+    bool        complete = true;
+
+    if (rate != 0.0 && width > 0.0 && phases != nullptr) {
+        updatePositional();
+        complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
+    }
+    else if (rate != 0.0 && width > 0.0) {
+        RainbowKernel   kernel = { SHSVRec(controller->framePhase(rate) * 360.0, 1.0, 1.0), 360.0f / width * detail };     // full cycle every rate seconds
+
+        renderPass(controller, area, kernel, detail);
+        if (detail > 1) {
+            fillSkipped();
         }
 
         complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
@@ -55,3 +88,9 @@ bool PxlFX_Rainbow::safeUpdate() {
 
     return complete;
 }
+
+void PxlFX_Rainbow::updatePositional() {
+    RainbowPositionalKernel kernel = { ramp, phases, (uint16_t)(controller->framePhase(rate) * 65536.0f) };
+
+    renderPass(controller, area, kernel);
+}
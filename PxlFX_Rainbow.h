@@ -13,13 +13,19 @@
 
 class PxlFX_Rainbow : public PxlFX {
 public:
-    PxlFX_Rainbow(PixelController *inController, float inRate, float inWidth, float inDur=0.0);
-    PxlFX_Rainbow(PixelController *inController, const JsonDocument &json);
+    PxlFX_Rainbow(PixelController *inController, float inRate, float inWidth, float inDur=0.0, uint8_t inFlags=0);
+    ~PxlFX_Rainbow();
     
+    void setArea(PixelAreaRec *inArea);
+    uint8_t keyframeInterval() { return keyframesFor(PixelController::tickRate() / rate); }     // a hue cycle every rate seconds
     bool safeUpdate();
 
 private:
-    float       startAngle;
+    void updatePositional();
+
+    uint8_t     flags;
+    uint16_t    *phases;        // positional mode only
+    SPixelRec   *ramp;
     float       rate;           // how long for pattern to move through a point
     float       width;          // how many LEDs wide
     float       duration;
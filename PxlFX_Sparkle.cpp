@@ -0,0 +1,87 @@
+//
+//  PxlFX_Sparkle.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "PxlFX_Sparkle.h"
+#include "PxlFXRender.h"
+
+PxlFX_Sparkle::PxlFX_Sparkle(PixelController *inController, float inRate, float inWidth, float inDur) : PxlFX(inController) {
+    rate = inRate;
+    width = inWidth;
+    duration = inDur;
+    pool = nullptr;
+    poolLen = 0;
+}
+
+PxlFX_Sparkle::~PxlFX_Sparkle() {
+    free(pool);
+}
+
+void PxlFX_Sparkle::setArea(PixelAreaRec *inArea) {
+    SHSVRec     baseColor = inArea->baseColor.clamped();
+    uint16_t    count = width > 0.0 ? min((float)kSPARKLE_MAX, width) : max(1, inArea->len / kSPARKLE_DEFAULT_RATIO);
+
+    PxlFX::setArea(inArea);
+
+    basePixel = ColorUtils::HSVtoPixel(baseColor);
+    peakPixel = ColorUtils::HSVtoPixel(SHSVRec(baseColor.hue, baseColor.sat * 0.25, 1.0));      // toward white
+    lifeTicks = constrain((rate > 0.0f ? rate : kSPARKLE_DEFAULT_LIFE) / controller->tickRate(), 2.0f, (float)kSPARKLE_MAX_LIFE);
+    seed = micros() | 1;
+    lastTick = controller->getTick();
+    needsBase = true;
+
+    count = min(count, (uint16_t)inArea->len);
+    if ((pool = (SparklePtr)malloc(sizeof(SparkleRec) * count)) != NULL) {
+        poolLen = count;
+        for (uint16_t i=0; i<poolLen; i++) {
+            spawn(&pool[i]);
+            pool[i].age = nextRandom() % pool[i].life;     // stagger the first round
+        }
+    }
+}
+
+// A new sparkle somewhere in the area, living 0.5 - 1.5 times the average
+
+void PxlFX_Sparkle::spawn(SparklePtr sparkle) {
+    sparkle->pixelIdx = area->map[nextRandom() % area->len];
+    sparkle->age = 0;
+    sparkle->life = lifeTicks / 2 + nextRandom() % lifeTicks;
+}
+
+bool PxlFX_Sparkle::safeUpdate() {
+    uint32_t    tick = controller->getTick();
+    uint16_t    elapsed = min(tick - lastTick, (uint32_t)UINT16_MAX);
+    SparklePtr  sparkle = pool;
+
+    if (needsBase) {
+        FillKernel  fill = { basePixel };
+
+        renderPass(controller, area, fill);
+        needsBase = false;
+    }
+
+    lastTick = tick;
+    for (uint16_t i=0; i<poolLen; i++, sparkle++) {
+        uint32_t    half;
+        uint32_t    weight;
+
+        if ((uint32_t)sparkle->age + elapsed >= sparkle->life) {
+            controller->setPixel(sparkle->pixelIdx, basePixel);
+            spawn(sparkle);
+        }
+        else {
+            sparkle->age += elapsed;
+        }
+
+        // brighten for the first half of its life, fade over the second
+        half = sparkle->life / 2;
+        weight = sparkle->age < half ? (sparkle->age << 8) / half : ((sparkle->life - sparkle->age) << 8) / (sparkle->life - half);
+        controller->setPixel(sparkle->pixelIdx, ColorUtils::blend(basePixel, peakPixel, weight));
+    }
+
+    return duration > 0.0 ? controller->tickTime(startTick) > duration : false;
+}
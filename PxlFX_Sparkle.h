@@ -0,0 +1,55 @@
+//
+//  PxlFX_Sparkle.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef PxlFX_Sparkle_h
+#define PxlFX_Sparkle_h
+
+#include "PxlFX.h"
+
+// Twinkles over the area's base color. The sparkles come from a pool sized
+// once in setArea and recycled as they burn out, so a frame only touches the
+// pixels that are currently lit and its cost follows the sparkle count rather
+// than the length of the area.
+
+#define kSPARKLE_DEFAULT_LIFE   1.0f    // seconds
+#define kSPARKLE_DEFAULT_RATIO  10      // one sparkle per this many pixels
+#define kSPARKLE_MAX            255
+#define kSPARKLE_MAX_LIFE       (UINT16_MAX / 3 * 2)      // ticks, so 1.5x the average still fits a SparkleRec life
+
+typedef struct {
+    uint16_t    pixelIdx;
+    uint16_t    age;            // ticks
+    uint16_t    life;
+} SparkleRec, *SparklePtr;
+
+class PxlFX_Sparkle : public PxlFX {
+public:
+    PxlFX_Sparkle(PixelController *inController, float inRate, float inWidth, float inDur=0.0);
+    ~PxlFX_Sparkle();
+
+    void setArea(PixelAreaRec *inArea);
+    bool safeUpdate();
+
+private:
+    void spawn(SparklePtr sparkle);
+    inline uint32_t nextRandom() { seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5; return seed; }     // xorshift32
+
+    SparklePtr  pool;
+    uint16_t    poolLen;
+    uint16_t    lifeTicks;
+    SPixelRec   basePixel;
+    SPixelRec   peakPixel;
+    uint32_t    seed;
+    uint32_t    lastTick;
+    bool        needsBase;      // whole area still needs the base color
+    float       rate;           // average sparkle life in seconds
+    float       width;          // number of sparkles, 0 for one per kSPARKLE_DEFAULT_RATIO pixels
+    float       duration;
+};
+
+#endif
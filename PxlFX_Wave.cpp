@@ -7,25 +7,35 @@
 //
 
 #include "PxlFX_Wave.h"
+#include "PxlFXRender.h"
 
-PxlFX_Wave::PxlFX_Wave(PixelController *inController, float inRate, float inWidth, float inDur) : PxlFX(inController) {
+PxlFX_Wave::PxlFX_Wave(PixelController *inController, float inRate, float inWidth, float inDur, uint8_t inFlags) : PxlFX(inController) {
     rate = inRate;
     width = inWidth;
     duration = inDur;
-    offset = 0.0;
+    flags = inFlags;
+    phases = nullptr;
+    ramp = nullptr;
 }
 
-PxlFX_Wave::PxlFX_Wave(PixelController *inController, const JsonDocument &json) : PxlFX(inController) {
-    rate = json["rate"];
-    width = json["width"];
-    duration = 0.0;
-    offset = 0.0;
+PxlFX_Wave::~PxlFX_Wave() {
+    free(phases);
+    free(ramp);
 }
 
 void PxlFX_Wave::setArea(PixelAreaRec *inArea) {
     PxlFX::setArea(inArea);
 
     baseColor = inArea->baseColor;
+    if ((flags & fx_flag_positional) && (phases = buildPhases(width)) != nullptr) {
+        if ((ramp = (SPixelRec *)malloc(sizeof(SPixelRec) * kVALUE_RAMP_LEN)) != NULL) {
+            ColorUtils::valueRamp(baseColor, ramp, kVALUE_RAMP_LEN);
+        }
+        else {
+            free(phases);
+            phases = nullptr;
+        }
+    }
 }
 
 #define USE_COS 0 
@@ -33,31 +43,70 @@ void PxlFX_Wave::setArea(PixelAreaRec *inArea) {
 // About 3x slower than triangle for not much difference. 
 // Add lookup table if we go this route
 
-bool PxlFX_Wave::safeUpdate() {
-    bool        complete = true;
+namespace {
+
+struct WaveKernel {
+    SHSVRec     color;
+    float       baseVal;
+    float       progress;
+    float       inc;
 
-    if (rate != 0.0 && width > 0.0) {
-        SHSVRec     color = baseColor;
-        uint16_t    *mapIdx = area->map;
-        float       inc = 1.0 / width;
-        float       progress = offset;
-        float       baseVal = color.val;
+    inline SPixelRec operator()(uint16_t idx) {
         float       mult;
         float       unused; // NULL?
 
-        for (int i=0; i<area->len; i++, mapIdx++) {
 #if USE_COS == 1
-            mult = (cosf(progress * M_TWOPI + M_PI) + 1.0) / 2.0;       // sine wave
+        mult = (cosf(progress * M_TWOPI + M_PI) + 1.0) / 2.0;       // sine wave
 #else
-            mult = fabs(modf(progress + 0.5, &unused) * 2.0 - 1.0);     // triangle wave
+        mult = fabs(modf(progress + 0.5, &unused) * 2.0 - 1.0);     // triangle wave
 #endif
-            controller->setPixel(*mapIdx, ColorUtils::HSVtoPixel(color.withVal(baseVal * mult)));
-            progress += inc;
+        progress += inc;
+
+        return ColorUtils::HSVtoPixel(color.withVal(baseVal * mult));
+    }
+};
+
+struct WavePositionalKernel {
+    const SPixelRec *ramp;
+    const uint16_t  *phases;
+    uint16_t        offset;
+
+    inline SPixelRec operator()(uint16_t idx) {
+        uint16_t    turns = offset + phases[idx] + 0x8000;
+        uint32_t    mult = abs((int32_t)turns * 2 - 0x10000);       // 0 - 0x10000
+
+        return ramp[mult >> 10];
+    }
+};
+
+}
+
+bool PxlFX_Wave::safeUpdate() {
+    bool        complete = true;
+
+    if (rate != 0.0 && width > 0.0 && phases != nullptr) {
+        updatePositional();
+        complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
+    }
+    else if (rate != 0.0 && width > 0.0) {
+        WaveKernel  kernel = { baseColor, baseColor.val, controller->framePhase(1.0 / rate), detail / width };     // rate cycles per second
+
+        renderPass(controller, area, kernel, detail);
+        if (detail > 1) {
+            fillSkipped();
         }
 
-        offset = modf(offset + (rate * controller->tickRate()), &unused);
         complete = duration > 0.0 ? controller->tickTime(startTick) > duration : false;
     }
 
     return complete;
 }
+
+// Same triangle wave as above but over the area's physical positions and all
+// in 16 bit turns, with the brightness curve coming from a precomputed ramp.
+
+void PxlFX_Wave::updatePositional() {
+    WavePositionalKernel    kernel = { ramp, phases, (uint16_t)(controller->framePhase(1.0 / rate) * 65536.0f) };
+
+    renderPass(controller, area, kernel);
+}
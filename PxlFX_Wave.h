@@ -13,15 +13,20 @@
 
 class PxlFX_Wave : public PxlFX {
 public:
-    PxlFX_Wave(PixelController *inController, float inRate, float inWidth, float inDur=0.0);
-    PxlFX_Wave(PixelController *inController, const JsonDocument &json);
+    PxlFX_Wave(PixelController *inController, float inRate, float inWidth, float inDur=0.0, uint8_t inFlags=0);
+    ~PxlFX_Wave();
     
     void setArea(PixelAreaRec *inArea);
+    uint8_t keyframeInterval() { return keyframesFor(PixelController::tickRate() * rate); }     // rate cycles per second
     bool safeUpdate();
 
 private:
+    void updatePositional();
+
     SHSVRec     baseColor;
-    float       offset;
+    uint8_t     flags;
+    uint16_t    *phases;        // positional mode only
+    SPixelRec   *ramp;
     float       rate;           // how long for pattern to move through a point
     float       width;          // how many LEDs wide
     float       duration;
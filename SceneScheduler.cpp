@@ -0,0 +1,306 @@
+//
+//  SceneScheduler.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "SceneScheduler.h"
+#include "config.h"
+#include <ArduinoJson.h>
+#include <LittleFS.h>
+
+#define kTRIGGER_CHECK_TICKS    30      // about once a second
+#define kMINUTES_PER_DAY        (24 * 60)
+
+SceneScheduler gSceneScheduler;
+
+SceneScheduler::SceneScheduler() {
+    steps = nullptr;
+    stepCount = 0;
+    playlists = nullptr;
+    playlistCount = 0;
+    triggers = nullptr;
+    triggerCount = 0;
+
+    loadRequested = false;
+    loadStartName[0] = 0;
+    activeList = kPLAYLIST_NONE;
+    curStep = 0;
+    stepEndTick = 0;
+    lastTick = 0;
+    lastTriggerCheck = 0;
+    lastMinute = -1;
+    nextTrigger = 0;
+}
+
+// Compile the JSON definition into flat step, playlist and trigger arrays. The
+// JSON document only lives for the duration of the load.
+
+bool SceneScheduler::load(const char *path) {
+    File                    file = LittleFS.open(path, "r");
+    uint16_t                sIdx = 0;
+    uint8_t                 pIdx = 0;
+
+    if (!file) {
+        return false;
+    }
+
+    DynamicJsonDocument     jsonDoc(file.size() * 2 + 256);
+    DeserializationError    error = deserializeJson(jsonDoc, file);
+
+    file.close();
+    if (error) {
+        Serial.print(F("Playlist load failed: "));
+        Serial.println(error.f_str());
+        return false;
+    }
+
+    JsonArrayConst  lists = jsonDoc["playlists"];
+    JsonArrayConst  trigs = jsonDoc["triggers"];
+    uint16_t        totalSteps = 0;
+
+    stop();
+    unload();
+
+    for (JsonObjectConst list : lists) {
+        totalSteps += list["steps"].size();
+    }
+
+    playlistCount = min(lists.size(), (size_t)kPLAYLIST_NONE - 1);
+    playlists = new PlaylistRec[playlistCount];
+    steps = new StepRec[totalSteps];
+    stepCount = totalSteps;
+
+    for (JsonObjectConst list : lists) {
+        PlaylistPtr listP;
+
+        if (pIdx >= playlistCount) {
+            break;
+        }
+        listP = &playlists[pIdx];
+
+        strlcpy(listP->name, list["name"] | "", sizeof(listP->name));
+        listP->loop = list["loop"] | false;
+        listP->firstStep = sIdx;
+        listP->stepCount = 0;
+
+        for (JsonObjectConst step : list["steps"].as<JsonArrayConst>()) {
+            PixelCommandRec *cmd = &steps[sIdx].cmd;
+            const char      *effectName = step["effect"];
+            float           duration = step["duration"] | 0.0f;
+
+            int             areaID = step["area"] | 0;
+
+            if (areaID < 0 || areaID >= kMAX_PIXEL_AREAS || gPixels->getArea(areaID)->len <= 0) {
+                Serial.printf_P(PSTR("Playlist %s: skipping step for invalid area %d\n"), listP->name, areaID);
+                continue;
+            }
+
+            cmd->areaID = areaID;
+            if (effectName != nullptr) {
+                cmd->fields = cmd_effect;
+                if (!PixelController::parseEffect(step, effectName, cmd->effect)) {
+                    Serial.printf_P(PSTR("Playlist %s: skipping step, file name too long\n"), listP->name);
+                    continue;
+                }
+                if (cmd->effect.type == fx_none && strcmp(effectName, "none")) {
+                    Serial.printf_P(PSTR("Playlist %s: skipping step for unknown effect %s\n"), listP->name, effectName);
+                    continue;
+                }
+            }
+            else {
+                cmd->fields = kCMD_COLOR_FIELDS;
+                cmd->isOn = step["on"] | true;
+                cmd->color.hue = step["color"]["h"] | 0.0f;
+                cmd->color.sat = (step["color"]["s"] | 0.0f) / 100.0;
+                cmd->color.val = (step["color"]["v"] | 100.0f) / 100.0;
+                cmd->transition = step["fade"] | 0.0f;
+            }
+            steps[sIdx].durationTicks = max((uint32_t)1, (uint32_t)(duration / PixelController::tickRate()));
+
+            sIdx++;
+            listP->stepCount++;
+        }
+        pIdx++;
+    }
+
+    triggers = new TriggerRec[min(trigs.size(), (size_t)kTRIGGER_MAX)];
+    for (JsonObjectConst trig : trigs) {
+        const char  *at = trig["at"] | "";
+        const char  *listName = trig["playlist"] | "";
+        int         hour, minute;
+        TriggerRec  newTrig;
+        int         tIdx;
+
+        if (triggerCount >= kTRIGGER_MAX) {
+            Serial.println(F("Playlist triggers: too many, ignoring the rest"));
+            break;
+        }
+        if (sscanf(at, "%d:%d", &hour, &minute) != 2) {
+            continue;
+        }
+
+        newTrig.minute = (hour * 60 + minute) % kMINUTES_PER_DAY;
+        newTrig.playlist = strcmp(listName, "stop") ? playlistIndex(listName) : kPLAYLIST_NONE;
+        if (newTrig.playlist == kPLAYLIST_NONE && strcmp(listName, "stop")) {
+            Serial.printf_P(PSTR("Playlist trigger at %s: unknown playlist %s, skipped\n"), at, listName);
+            continue;
+        }
+
+        // keep sorted by time of day
+        for (tIdx=triggerCount; tIdx>0 && triggers[tIdx - 1].minute > newTrig.minute; tIdx--) {
+            triggers[tIdx] = triggers[tIdx - 1];
+        }
+        triggers[tIdx] = newTrig;
+        triggerCount++;
+    }
+    lastMinute = -1;    // re-seek on the next trigger check
+
+    Serial.printf_P(PSTR("Playlists: %d lists, %d steps, %d triggers\n"), playlistCount, stepCount, triggerCount);
+
+    return true;
+}
+
+// The AsyncTCP handlers can't read the file or replace the arrays under loop(),
+// so they ask for the load here. A playlist named along with the request is
+// started from the new definitions, since load() stops whatever was running.
+
+void SceneScheduler::requestLoad(const char *startName) {
+    strlcpy(loadStartName, startName != nullptr ? startName : "", sizeof(loadStartName));
+    loadRequested = true;
+}
+
+void SceneScheduler::unload() {
+    delete[] steps;
+    delete[] playlists;
+    delete[] triggers;
+
+    steps = nullptr;
+    stepCount = 0;
+    playlists = nullptr;
+    playlistCount = 0;
+    triggers = nullptr;
+    triggerCount = 0;
+}
+
+void SceneScheduler::loop() {
+    uint32_t    tick = gPixels->getTick();
+
+    if (loadRequested) {
+        loadRequested = false;
+        if (load() && loadStartName[0] && strcmp(loadStartName, "stop") && !start(loadStartName)) {
+            Serial.printf_P(PSTR("Playlist %s: not found after reload\n"), loadStartName);
+        }
+    }
+
+    if (tick == lastTick) {
+        return;
+    }
+    lastTick = tick;
+
+    if (tick - lastTriggerCheck >= kTRIGGER_CHECK_TICKS) {
+        lastTriggerCheck = tick;
+        checkTriggers();
+    }
+
+    if (activeList != kPLAYLIST_NONE && (int32_t)(tick - stepEndTick) >= 0) {
+        PlaylistPtr listP = &playlists[activeList];
+        uint16_t    nextStep = curStep + 1;
+
+        if (nextStep >= listP->firstStep + listP->stepCount) {
+            if (!listP->loop) {
+                stop();
+                return;
+            }
+            nextStep = listP->firstStep;
+        }
+        startStep(nextStep);
+    }
+}
+
+bool SceneScheduler::start(const char *name) {
+    uint8_t listIdx = playlistIndex(name);
+
+    if (listIdx == kPLAYLIST_NONE || playlists[listIdx].stepCount == 0) {
+        return false;
+    }
+
+    activeList = listIdx;
+    startStep(playlists[listIdx].firstStep);
+
+    return true;
+}
+
+void SceneScheduler::stop() {
+    activeList = kPLAYLIST_NONE;    // lights stay as they are
+}
+
+const char *SceneScheduler::activeName() {
+    return activeList != kPLAYLIST_NONE ? playlists[activeList].name : "none";
+}
+
+uint8_t SceneScheduler::playlistIndex(const char *name) {
+    for (uint8_t pIdx=0; name != nullptr && pIdx<playlistCount; pIdx++) {
+        if (!strcmp(playlists[pIdx].name, name)) {
+            return pIdx;
+        }
+    }
+
+    return kPLAYLIST_NONE;
+}
+
+void SceneScheduler::startStep(uint16_t stepIdx) {
+    curStep = stepIdx;
+    stepEndTick = gPixels->getTick() + steps[stepIdx].durationTicks;
+    gPixels->queueCommand(steps[stepIdx].cmd);
+}
+
+void SceneScheduler::checkTriggers() {
+    time_t      now = time(NULL);
+    struct tm   localNow;
+    int16_t     minute;
+
+    if (triggerCount == 0 || now < kEPOCH_01012022) {
+        return;     // nothing to do or no NTP time yet
+    }
+
+    localtime_r(&now, &localNow);
+    minute = localNow.tm_hour * 60 + localNow.tm_min;
+
+    if (minute == lastMinute) {
+        return;
+    }
+
+    // On the first check, or if the clock jumped, find our place without firing
+    if (lastMinute < 0 || minute != (lastMinute + 1) % kMINUTES_PER_DAY) {
+        seekTrigger(minute);
+        lastMinute = minute;
+        return;
+    }
+    lastMinute = minute;
+
+    for (uint8_t count=0; count<triggerCount && triggers[nextTrigger].minute == minute; count++) {
+        TriggerPtr  trigP = &triggers[nextTrigger];
+
+        if (trigP->playlist == kPLAYLIST_NONE) {
+            stop();
+        }
+        else {
+            start(playlists[trigP->playlist].name);
+        }
+        nextTrigger = (nextTrigger + 1) % triggerCount;
+    }
+}
+
+void SceneScheduler::seekTrigger(uint16_t minute) {
+    nextTrigger = 0;
+
+    for (uint8_t tIdx=0; tIdx<triggerCount; tIdx++) {
+        if (triggers[tIdx].minute > minute) {
+            nextTrigger = tIdx;
+            break;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+//
+//  SceneScheduler.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef SceneScheduler_h
+#define SceneScheduler_h
+
+#include "PixelController.h"
+
+// Runs playlists of scenes on the device so effect changes don't depend on
+// Home Assistant being up. Playlists and time-of-day triggers are defined in a
+// JSON file on LittleFS which is compiled at load into flat arrays of steps.
+// Each tick costs at most one comparison against the current step's end tick
+// and, once a second, one comparison against the next trigger.
+//
+// Example /playlists.json:
+// {
+//   "playlists": [
+//     { "name": "evening", "loop": true, "steps": [
+//       { "area": 0, "color": { "h": 30, "s": 80, "v": 60 }, "duration": 600, "fade": 5 },
+//       { "area": 0, "effect": "rainbow", "rate": 20, "width": 120, "duration": 300 }
+//     ] }
+//   ],
+//   "triggers": [ { "at": "18:30", "playlist": "evening" }, { "at": "23:00", "playlist": "stop" } ]
+// }
+//
+// Durations and fades are in seconds. Fades apply to color steps; effect
+// steps start immediately.
+
+#define kPLAYLIST_PATH          "/playlists.json"
+#define kPLAYLIST_NAME_LEN      16
+#define kPLAYLIST_NONE          0xFF
+#define kTRIGGER_MAX            0xFF    // triggerCount is a uint8_t
+
+class SceneScheduler {
+public:
+    SceneScheduler();
+
+    bool load(const char *path=kPLAYLIST_PATH);
+    void loop();
+
+    void requestLoad(const char *startName=nullptr);     // load() from the next loop(), for the AsyncTCP handlers
+
+    bool start(const char *name);
+    void stop();
+    const char *activeName();
+
+private:
+    typedef struct {
+        PixelCommandRec cmd;
+        uint32_t        durationTicks;
+    } StepRec, *StepPtr;
+
+    typedef struct {
+        char            name[kPLAYLIST_NAME_LEN];
+        uint16_t        firstStep;
+        uint16_t        stepCount;
+        bool            loop;
+    } PlaylistRec, *PlaylistPtr;
+
+    typedef struct {
+        uint16_t        minute;     // minute of the day
+        uint8_t         playlist;   // kPLAYLIST_NONE to stop
+    } TriggerRec, *TriggerPtr;
+
+    void unload();
+    uint8_t playlistIndex(const char *name);
+    void startStep(uint16_t stepIdx);
+    void checkTriggers();
+    void seekTrigger(uint16_t minute);
+
+    StepPtr         steps;
+    uint16_t        stepCount;
+    PlaylistPtr     playlists;
+    uint8_t         playlistCount;
+    TriggerPtr      triggers;
+    uint8_t         triggerCount;
+
+    bool            loadRequested;
+    char            loadStartName[kPLAYLIST_NAME_LEN];      // started once the requested load is done
+    uint8_t         activeList;
+    uint16_t        curStep;
+    uint32_t        stepEndTick;
+    uint32_t        lastTick;
+    uint32_t        lastTriggerCheck;
+    int16_t         lastMinute;
+    uint8_t         nextTrigger;
+};
+
+extern SceneScheduler gSceneScheduler;
+
+#endif
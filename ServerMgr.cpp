@@ -8,6 +8,15 @@
 
 #include "ServerMgr.h"
 #include "PixelController.h"
+#include "PxlFX_Progress.h"
+#include "SceneScheduler.h"
+#include "FrameRecorder.h"
+#include "SyncClock.h"
+#include "LoopScheduler.h"
+#include "LoadTest.h"
+#include "CommandTrace.h"
+#include "NetworkMgr.h"
+#include "UploadStager.h"
 #include "config.h"
 #include <LittleFS.h>
 
@@ -46,7 +55,9 @@ R"==(<!doctype html><html lang='en'>
         for (var i = 0; i < fls.length; i++) {
             formData.append('file', fls[i], '/' + fls[i].name);
         }
-        fetch('/', { method: 'POST', body: formData }).then(function () { window.alert('done.'); });
+        fetch('/', { method: 'POST', body: formData })
+            .then(function (result) { return result.json(); })
+            .then(function (json) { window.alert(json.result + ': ' + json.bytes + ' bytes @ ' + json.kbps + ' KB/s'); });
     }
     var z = document.getElementById('zone');
     z.addEventListener('dragenter', dragHelper, false);
@@ -57,189 +68,878 @@ R"==(<!doctype html><html lang='en'>
 )==";
 
 #define BUILD_TIME      __DATE__ " " __TIME__
+#define kJSON_TYPE      "application/json; charset=utf-8"
+#define kFS_NAME_LEN    72      // room for an escaped LittleFS name
+#define kBATCH_MAX_BODY 2048
 
-class FileServerHandler : public RequestHandler {
+// Note: Handlers run from the AsyncTCP callbacks, not from loop(). They must not
+// block or yield. Anything that touches the pixels goes through the command queue
+// and anything slow (e.g. restarting after an update) is deferred to loop().
+
+// Uploads are staged by UploadStager, which keeps its state in the request's
+// _tempObject and writes through the request's _tempFile.
+
+class FileServerHandler : public AsyncWebHandler {
 public:
     FileServerHandler() { }
 
-    bool canHandle(HTTPMethod requestMethod, const String &uri) override {
-        return (requestMethod == HTTP_POST) || (requestMethod == HTTP_DELETE);
-    }
-
-    bool canUpload(const String &uri) override {
-        return uri == "/";     // currently only allow upload on root fs level.
+    bool canHandle(AsyncWebServerRequest *request) override {
+        // currently only allow upload on root fs level.
+        return (request->method() == HTTP_POST && request->url() == "/") || (request->method() == HTTP_DELETE);
     }
 
-    bool handle(ESP8266WebServer &server, HTTPMethod requestMethod, const String &requestUri) override {
-        String fName = requestUri;
-
-        if (!fName.startsWith("/")) {
-            fName = "/" + fName;
-        }
+    void handleRequest(AsyncWebServerRequest *request) override {
+        UploadStatePtr  state = (UploadStatePtr)request->_tempObject;
 
         // HTTP_POST done in upload. no other forms.
-        if (requestMethod == HTTP_DELETE) {
+        if (request->method() == HTTP_DELETE) {
+            String fName = request->url();
+
+            if (!fName.startsWith("/")) {
+                fName = "/" + fName;
+            }
             if (LittleFS.exists(fName)) {
                 LittleFS.remove(fName);
             }
+            request->send(200);
         }
+        else if (state != nullptr) {
+            uint32_t    elapsed = max((uint32_t)1, millis() - state->startTime);
+            char        result[96];
 
-        server.send(200);
+            snprintf_P(result, sizeof(result), PSTR("{ \"result\": \"%s\", \"files\": %u, \"bytes\": %u, \"ms\": %u, \"kbps\": %u }"),
+                state->failed ? "failed" : "ok", state->fileCount, state->totalBytes, elapsed, (uint32_t)((uint64_t)state->totalBytes * 1000 / 1024 / elapsed));
+            request->send(state->failed ? 500 : 200, F(kJSON_TYPE), result);
+        }
+        else {
+            request->send(500, F(kJSON_TYPE), F("{ \"result\": \"failed\" }"));
+        }
+    }
+
+    void handleUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) override {
+        // Each request carries its own state and file so concurrent uploads don't collide
+        UploadStatePtr  state = (UploadStatePtr)request->_tempObject;
+
+        if (state == nullptr) {
+            if ((state = (UploadStatePtr)malloc(sizeof(UploadStateRec))) == nullptr) {
+                return;
+            }
+            request->_tempObject = state;       // freed along with the request
+            UploadStager::begin(state);
+        }
+
+        if (index == 0) {
+            UploadStager::beginFile(state, request->_tempFile, filename.c_str());
+        }
+        UploadStager::append(state, request->_tempFile, data, len);
+        if (final) {
+            UploadStager::finishFile(state, request->_tempFile);
+        }
+    }
+
+    bool isRequestHandlerTrivial() override { return false; }
+};
+
+// Serves files from LittleFS, preferring a pre-compressed .gz variant (see
+// tools/gzip_data.sh). Responses carry an ETag built from the file's write time
+// and size so repeat visits get a 304 instead of another full read and transfer.
+// Images are treated as immutable and cached for a long time, everything else
+// must be revalidated. The file itself is sent in chunks from the TCP callbacks
+// as the window opens up.
+
+class AssetHandler : public AsyncWebHandler {
+public:
+    AssetHandler() { }
+
+    bool canHandle(AsyncWebServerRequest *request) override {
+        String  path;
+
+        if (request->method() != HTTP_GET) {
+            return false;
+        }
+
+        path = assetPath(request);
+        if (!LittleFS.exists(path) && !LittleFS.exists(path + F(".gz"))) {
+            return false;
+        }
+
+        request->addInterestingHeader(F("Accept-Encoding"));
+        request->addInterestingHeader(F("If-None-Match"));
 
         return true;
     }
 
-    void upload(ESP8266WebServer &server, const String &requestUri, HTTPUpload &upload) override {
-        String fName = upload.filename;
-        if (!fName.startsWith("/")) {
-            fName = "/" + fName;
+    void handleRequest(AsyncWebServerRequest *request) override {
+        AsyncWebServerResponse  *response;
+        String                  path = assetPath(request);
+        String                  gzPath = path + F(".gz");
+        String                  eTag;
+        bool                    acceptsGzip = request->hasHeader(F("Accept-Encoding")) && request->getHeader(F("Accept-Encoding"))->value().indexOf(F("gzip")) >= 0;
+        File                    file;
+
+        if (LittleFS.exists(gzPath) && (acceptsGzip || !LittleFS.exists(path))) {
+            file = LittleFS.open(gzPath, "r");
+        }
+        else {
+            file = LittleFS.open(path, "r");
         }
 
-        if (upload.status == UPLOAD_FILE_START) {
-            if (LittleFS.exists(fName)) {
-                LittleFS.remove(fName);
-            } // if
-            _fsUploadFile = LittleFS.open(fName, "w");
-        } 
-        else if (upload.status == UPLOAD_FILE_WRITE) {
-            if (_fsUploadFile) {
-                _fsUploadFile.write(upload.buf, upload.currentSize);
+        if (!file) {
+            request->send(404);
+            return;
+        }
+
+        eTag = makeETag(file);
+        if (request->hasHeader(F("If-None-Match")) && request->getHeader(F("If-None-Match"))->value() == eTag) {
+            file.close();
+            response = request->beginResponse(304);
+        }
+        else {
+            // AsyncFileResponse adds Content-Encoding: gzip when given a .gz file for a plain path
+            response = request->beginResponse(file, path);
+        }
+
+        response->addHeader(F("ETag"), eTag);
+        response->addHeader(F("Cache-Control"), isImmutable(path) ? F("public, max-age=31536000, immutable") : F("no-cache"));
+        response->addHeader(F("Vary"), F("Accept-Encoding"));
+        request->send(response);
+    }
+
+protected:
+    static String assetPath(AsyncWebServerRequest *request) {
+        String  path = request->url();
+
+        if (path.endsWith("/")) {
+            path += F("index.html");
+        }
+
+        return path;
+    }
+
+    static String makeETag(File &file) {
+        char    tag[24];
+
+        snprintf_P(tag, sizeof(tag), PSTR("\"%08x-%x\""), (uint32_t)file.getLastWrite(), (uint32_t)file.size());
+
+        return String(tag);
+    }
+
+    static bool isImmutable(const String &path) {
+        return path.endsWith(F(".png")) || path.endsWith(F(".jpg")) || path.endsWith(F(".svg")) || path.endsWith(F(".ico"));
+    }
+};
+
+// Copies src into dst as the inside of a JSON string: quotes and backslashes are
+// escaped and control characters written as \u00XX. Returns false if it
+// didn't all fit, with dst holding as much as did.
+
+static bool escapeJSON(const char *src, char *dst, size_t dstLen) {
+    size_t  dIdx = 0;
+
+    for (; *src; src++) {
+        uint8_t c = *src;
+
+        if (c < 0x20) {
+            if (dIdx + 6 >= dstLen) {
+                dst[dIdx] = 0;
+                return false;
             }
-        } 
-        else if (upload.status == UPLOAD_FILE_END) {
-            if (_fsUploadFile) {
-                _fsUploadFile.close();
+            dIdx += snprintf_P(dst + dIdx, dstLen - dIdx, PSTR("\\u%04x"), c);
+        }
+        else {
+            if (dIdx + ((c == '"' || c == '\\') ? 2 : 1) >= dstLen) {
+                dst[dIdx] = 0;
+                return false;
+            }
+            if (c == '"' || c == '\\') {
+                dst[dIdx++] = '\\';
+            }
+            dst[dIdx++] = c;
+        }
+    }
+    dst[dIdx] = 0;
+
+    return true;
+}
+
+// Base for chunked JSON responses which are produced a piece at a time as the
+// response asks for more data, so memory use doesn't depend on the size of the
+// whole body. A piece that doesn't fit in the current chunk is held over. A
+// piece that doesn't fit in the piece buffer ends the response rather than
+// sending a truncated (and invalid) document.
+
+#define kPIECE_LEN      192
+
+class ChunkStreamer {
+public:
+    ChunkStreamer() {
+        pieceLen = 0;
+        pieceOffset = 0;
+    }
+    virtual ~ChunkStreamer() { }
+
+    size_t fill(uint8_t *buffer, size_t maxLen) {
+        size_t  written = 0;
+
+        while (written < maxLen) {
+            size_t  count;
+
+            if (pieceOffset >= pieceLen && !nextPiece()) {
+                break;
             }
+
+            count = min(maxLen - written, pieceLen - pieceOffset);
+            memcpy(buffer + written, piece + pieceOffset, count);
+            written += count;
+            pieceOffset += count;
         }
+
+        return written;     // 0 ends the response
     }
 
 protected:
-    File _fsUploadFile;
+    virtual bool nextPiece() = 0;       // fills piece, false when done
+
+    // Takes the length snprintf reported, false if the piece didn't fit
+    bool setPiece(int len) {
+        pieceOffset = 0;
+        if (len < 0 || (size_t)len >= sizeof(piece)) {
+            Serial.printf_P(PSTR("Chunked response: piece needs %d of %u bytes, ending response\n"), len, sizeof(piece));
+            pieceLen = 0;
+            return false;
+        }
+        pieceLen = len;
+
+        return true;
+    }
+
+    char    piece[kPIECE_LEN];
+    size_t  pieceLen;
+    size_t  pieceOffset;
 };
 
-ServerMgr::ServerMgr() {
+// The /$fs listing, one directory entry per piece
+
+class FileListStreamer : public ChunkStreamer {
+public:
+    FileListStreamer(const Dir &inDir) : dir(inDir) {
+        state = list_start;
+    }
+
+protected:
+    enum { list_start, list_first, list_next, list_done };
+
+    bool nextPiece() {
+        setPiece(0);
+
+        switch (state) {
+            case list_start:
+                piece[0] = '[';
+                setPiece(1);
+                state = list_first;
+                break;
+
+            case list_first:
+            case list_next:
+                if (dir.next()) {
+                    char    name[kFS_NAME_LEN * 2];
+
+                    if (!escapeJSON(dir.fileName().c_str(), name, sizeof(name))) {
+                        setPiece(-1);
+                        break;
+                    }
+                    setPiece(snprintf_P(piece, sizeof(piece), PSTR("%s{\"name\":\"%s\",\"size\":%u,\"time\":%ld}"),
+                        state == list_next ? "," : "", name, (uint32_t)dir.fileSize(), (long)dir.fileTime()));
+                    state = list_next;
+                }
+                else {
+                    piece[0] = ']';
+                    setPiece(1);
+                    state = list_done;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        return pieceLen > 0;
+    }
+
+    Dir     dir;
+    int     state;
+};
+
+// /$sysinfo, one group of fields per piece. Values are read as each piece is
+// produced so nothing is held for the life of the response.
+
+class SysInfoStreamer : public ChunkStreamer {
+public:
+    SysInfoStreamer(time_t inBootTime) {
+        bootTime = inBootTime;
+        section = 0;
+    }
+
+protected:
+    bool nextPiece() {
+        setPiece(0);
+
+        switch (section++) {
+            case 0:
+                setPiece(snprintf_P(piece, sizeof(piece), PSTR("{\"project\":\"%s\",\"buildTime\":\"%s\","), kPROJ_TITLE, BUILD_TIME));
+                break;
+
+            case 1:
+                setPiece(snprintf_P(piece, sizeof(piece), PSTR("\"versionSDK\":\"%s\",\"versionCore\":\"%s\",\"versionBoot\":%u,"),
+                    ESP.getSdkVersion(), ESP.getCoreVersion().c_str(), ESP.getBootVersion()));
+                break;
+
+            case 2: {
+                char    fullVersion[kPIECE_LEN - 20];
+
+                if (!escapeJSON(ESP.getFullVersion().c_str(), fullVersion, sizeof(fullVersion))) {
+                    setPiece(-1);
+                    break;
+                }
+                setPiece(snprintf_P(piece, sizeof(piece), PSTR("\"versionFull\":\"%s\","), fullVersion));
+                break;
+            }
+
+            case 3:
+                setPiece(snprintf_P(piece, sizeof(piece),
+                    PSTR("\"flashSize\":%u,\"freeHeap\":%u,\"heapFrag\":%u,\"sketchSize\":%u,\"sketchSpace\":%u,"),
+                    ESP.getFlashChipSize(), ESP.getFreeHeap(), ESP.getHeapFragmentation(), ESP.getSketchSize(), ESP.getFreeSketchSpace()));
+                break;
+
+            case 4: {
+                FSInfo  fs_info;
+
+                LittleFS.info(fs_info);
+                setPiece(snprintf_P(piece, sizeof(piece), PSTR("\"fsTotalBytes\":%u,\"fsUsedBytes\":%u,\"bootTime\":%ld,\"curTime\":%ld,"),
+                    (uint32_t)fs_info.totalBytes, (uint32_t)fs_info.usedBytes, (long)bootTime, (long)time(NULL)));
+                break;
+            }
+
+            case 5: {
+                const PowerStatsRec &power = gPixels->getPowerStats();
+
+                setPiece(snprintf_P(piece, sizeof(piece),
+                    PSTR("\"power\":{\"budget\":%u,\"estimate\":%u,\"peak\":%u,\"scale\":%u,\"limitedFrames\":%u,\"limitEvents\":%u},"),
+                    gPixels->getPowerBudget(), power.estimate, power.peak, power.scale, power.limitedFrames, power.limitEvents));
+                break;
+            }
+
+            case 6: {
+                const SyncStatsRec  &sync = gSyncClock.getStats();
+
+                setPiece(snprintf_P(piece, sizeof(piece),
+                    PSTR("\"sync\":{\"leader\":%u,\"isLeader\":%s,\"error\":%d,\"beacons\":%u,\"steps\":%u},"),
+                    sync.leaderID, sync.isLeader ? "true" : "false", sync.error, sync.beacons, sync.steps));
+                break;
+            }
+
+            case 7: {
+                const MQTTHeapStatsRec  &mqtt = gNetworkMgr.getHeapStats();
+
+                setPiece(snprintf_P(piece, sizeof(piece), PSTR("\"mqtt\":{\"messages\":%u,\"states\":%u,\"heapLost\":%u}}"),
+                    mqtt.messages, mqtt.states, mqtt.heapLost));
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        return pieceLen > 0;
+    }
+
+    time_t  bootTime;
+    uint8_t section;
+};
+
+ServerMgr::ServerMgr() : server(80) {
+    restartTime = 0;
+    updateProgress = 0.0;
+    updateTotal = 0;
+    updateCompressed = false;
+    updateActive = false;
+    updateShowStart = false;
+    updateShowFailed = false;
 }
 
 void ServerMgr::setup() {
     bootTime = time(NULL);
+    UploadStager::removeStale();
 
-    server.on(F("/minup.html"), [this]() { this->handleBasicUpload(); });
-    server.on(F("/"), HTTP_GET, [this]() { this->handleRedirect(); });
+    server.on("/minup.html", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleBasicUpload(request); });
+    server.on("/", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleRedirect(request); });
 
     // OTA Update handler
-    httpUpdater.setup(&server, "/otaupdate");
-    // Note: this required a change to Updater.cpp as writeStream calls the progress handler
-    // but not write. Consider creating an HTTP updater that contains its own progress handler
-    Update.onProgress([](size_t progress, size_t len) {
-        // progress from Updater is currently broken as it gives the size of the destination
-        // insteaed of the source. we'll just blink the LEDs on each update for now.
-        static bool pToggle = true;
-        SHSVRec color = ColorUtils::purple.withVal(pToggle ? 0.5 : 0.1);
-        
-        gPixels->setAreaColor(area_status_1, color);
-        gPixels->setAreaColor(area_status_2, color);
-        gPixels->show();
-        pToggle = !pToggle;
-    });
+    server.on("/otaupdate", HTTP_GET, [](AsyncWebServerRequest *request) { request->redirect(F("/update.html")); });
+    server.on("/otaupdate", HTTP_POST,
+        [this](AsyncWebServerRequest *request) { this->handleUpdateDone(request); },
+        [this](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
+            this->handleUpdateUpload(request, filename, index, data, len, final);
+        });
 
     // register some REST services
-    server.on(F("/$fs"), HTTP_GET, [this]() { this->handleFileList(); });
-    server.on(F("/$sysinfo"), HTTP_GET, [this]() { this->handleSysInfo(); });
-    server.on(F("/$effect"), HTTP_GET, [this]() { this->handleEffect(); });
+    server.on("/$fs", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleFileList(request); });
+    server.on("/$sysinfo", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleSysInfo(request); });
+    server.on("/$effect", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleEffect(request); });
+    server.on("/$playlist", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handlePlaylist(request); });
+    server.on("/$record", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleRecord(request); });
+    server.on("/$tasks", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleTasks(request); });
+    server.on("/$loadtest", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleLoadTest(request); });
+    server.on("/$trace", HTTP_GET, [this](AsyncWebServerRequest *request) { this->handleTrace(request); });
+    server.on("/$commands", HTTP_POST,
+        [this](AsyncWebServerRequest *request) { this->handleCommands(request); }, nullptr,
+        [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+            this->handleCommandsBody(request, data, len, index, total);
+        });
     server.addHandler(new FileServerHandler());
 
-    server.serveStatic("/", LittleFS, "/");
-    server.onNotFound([this]() { this->handleNotFound(); });
+    server.addHandler(new AssetHandler());
+    server.onNotFound([this](AsyncWebServerRequest *request) { this->handleNotFound(request); });
 
-    server.begin(80);
+    server.begin();
     Serial.println(F("Web server listening on port 80"));
 }
 
 void ServerMgr::loop() {
-    // Note: Made changes to streamFile in ESP8266WebServer.h to use file.sendSize instead of
-    // file.sendAll which can delay up to 1 second waiting for Stream (aka File) to make more
-    // data available to send. Probably I should figure out how to send a PR to the good folks
-    // at https://github.com/esp8266/Arduino
-
-    server.handleClient();
-}
-
-void ServerMgr::handleFileList() {
-    StaticJsonDocument<1024> jsonDoc;
-    Dir         dir = LittleFS.openDir("/");
-    String      result;
-    int16_t     idx = 0;
-
-    while (dir.next()) {
-        jsonDoc[idx][F("name")] = dir.fileName();
-        jsonDoc[idx][F("size")] = dir.fileSize();
-        jsonDoc[idx][F("time")] = dir.fileTime();
-        idx++;
-    }
-
-    serializeJson(jsonDoc, result);
-    server.sendHeader(F("Cache-Control"), F("no-cache"));
-    server.send(200, F("application/json; charset=utf-8"), result);
-}
-
-void ServerMgr::handleSysInfo() {
-    StaticJsonDocument<512> jsonDoc;
-    String      result;
-    FSInfo      fs_info;
-    time_t      now = time(NULL);
-
-    LittleFS.info(fs_info);
-
-    jsonDoc[F("project")] = kPROJ_TITLE;
-    jsonDoc[F("buildTime")] = BUILD_TIME;
-    jsonDoc[F("versionSDK")] = ESP.getSdkVersion();
-    jsonDoc[F("versionCore")] = ESP.getCoreVersion();
-    jsonDoc[F("versionFull")] = ESP.getFullVersion();
-    jsonDoc[F("versionBoot")] = ESP.getBootVersion();
-    jsonDoc[F("flashSize")] = ESP.getFlashChipSize();
-    jsonDoc[F("freeHeap")] = ESP.getFreeHeap();
-    jsonDoc[F("heapFrag")] = ESP.getHeapFragmentation();
-    jsonDoc[F("sketchSize")] = ESP.getSketchSize();
-    jsonDoc[F("sketchSpace")] = ESP.getFreeSketchSpace();
-    jsonDoc[F("fsTotalBytes")] = fs_info.totalBytes;
-    jsonDoc[F("fsUsedBytes")] = fs_info.usedBytes;
-    jsonDoc[F("bootTime")] = bootTime;
-    jsonDoc[F("curTime")] = now;
-    serializeJson(jsonDoc, result);
-
-    server.sendHeader(F("Cache-Control"), F("no-cache"));
-    server.send(200, F("application/json; charset=utf-8"), result);
-}
-
-void ServerMgr::handleEffect() {
+    // Requests are serviced from the AsyncTCP callbacks. All that's left for
+    // loop() is work that can't happen there.
+
+    if (updateShowStart) {
+        updateShowStart = false;
+        gPixels->setAreaColor(area_status_1, ColorUtils::purple.withVal(0.10));
+        gPixels->setAreaColor(area_status_2, ColorUtils::purple.withVal(0.10));
+        gPixels->setAreaEffect(kOTA_PROGRESS_AREA, new PxlFX_Progress(gPixels, ColorUtils::purple.withVal(0.5), &updateProgress));
+    }
+    if (updateShowFailed) {
+        // Drop the progress bar and repaint whatever was underneath it
+        updateShowFailed = false;
+        gPixels->setAreaColor(area_status_1, ColorUtils::red.withVal(0.10));
+        gPixels->setAreaColor(area_status_2, ColorUtils::red.withVal(0.10));
+        gPixels->clearAreaEffect(kOTA_PROGRESS_AREA);
+        gPixels->refreshArea(kOTA_PROGRESS_AREA);
+        gPixels->refreshArea(area_main);
+    }
+
+    if (restartTime != 0 && millis() - restartTime > kRESTART_DELAY) {
+        ESP.restart();
+    }
+}
+
+void ServerMgr::handleFileList(AsyncWebServerRequest *request) {
+    FileListStreamer        streamer(LittleFS.openDir("/"));
+    AsyncWebServerResponse  *response;
+
+    response = request->beginChunkedResponse(F(kJSON_TYPE), [streamer](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+        return streamer.fill(buffer, maxLen);
+    });
+    response->addHeader(F("Cache-Control"), F("no-cache"));
+    request->send(response);
+}
+
+void ServerMgr::handleSysInfo(AsyncWebServerRequest *request) {
+    SysInfoStreamer         streamer(bootTime);
+    AsyncWebServerResponse  *response;
+
+    response = request->beginChunkedResponse(F(kJSON_TYPE), [streamer](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+        return streamer.fill(buffer, maxLen);
+    });
+    response->addHeader(F("Cache-Control"), F("no-cache"));
+    request->send(response);
+}
+
+void ServerMgr::handleEffect(AsyncWebServerRequest *request) {
     StaticJsonDocument<256> jsonDoc;
-    int                     argCount = server.args();
+    int                     argCount = request->params();
 
     for (int i=0; i<argCount; i++) {
-        jsonDoc[server.argName(i)] = server.arg(i);
+        AsyncWebParameter   *param = request->getParam(i);
+
+        jsonDoc[param->name()] = param->value();
+    }
+    gCommandTrace.recordWeb(jsonDoc);
+    if (gPixels->handleWebCommand(jsonDoc)) {
+        request->send(200, F(kJSON_TYPE), F("{ \"result\": \"ok\" }"));
+    }
+    else {
+        request->send(400, F(kJSON_TYPE), F("{ \"result\": \"failed: unknown effect or area, file name too long or queue full\" }"));
+    }
+}
+
+// /$playlist?name=<playlist> starts a playlist, name=stop stops it and
+// reload=1 re-reads the definitions from the scenes task. A name given with
+// reload=1 is started from the new definitions once they are loaded, so "ok"
+// then only means the request was accepted. Always reports the active playlist.
+
+void ServerMgr::handlePlaylist(AsyncWebServerRequest *request) {
+    AsyncResponseStream *response;
+    bool                ok = true;
+
+    if (request->hasParam("reload")) {
+        gSceneScheduler.requestLoad(request->hasParam("name") ? request->getParam("name")->value().c_str() : nullptr);
+    }
+    else if (request->hasParam("name")) {
+        const String    &name = request->getParam("name")->value();
+
+        if (name == "stop") {
+            gSceneScheduler.stop();
+        }
+        else {
+            ok = gSceneScheduler.start(name.c_str());
+        }
+    }
+
+    response = request->beginResponseStream(F(kJSON_TYPE));
+    response->printf_P(PSTR("{ \"result\": \"%s\", \"active\": \"%s\" }"), ok ? "ok" : "failed", gSceneScheduler.activeName());
+    request->send(response);
+}
+
+// /$record?area=0&frames=300&file=/rec.klr[&every=1] starts capturing an area
+// from the live buffer, stop=1 ends it early. Always reports recorder status.
+// The file name is limited to kFX_PATH_LEN - 1 so it can be played back, and the
+// recorder task opens it, so "ok" means the request was accepted.
+// Play it back with /$effect?name=playback&area=0&file=/rec.klr
+
+void ServerMgr::handleRecord(AsyncWebServerRequest *request) {
+    AsyncResponseStream *response;
+    bool                ok = true;
+
+    if (request->hasParam("stop")) {
+        gFrameRecorder.requestEnd();
+    }
+    else if (request->hasParam("file")) {
+        uint16_t    area = request->hasParam("area") ? request->getParam("area")->value().toInt() : 0;
+        uint16_t    frames = request->hasParam("frames") ? request->getParam("frames")->value().toInt() : 0;
+        uint16_t    every = request->hasParam("every") ? request->getParam("every")->value().toInt() : 1;
+
+        ok = gFrameRecorder.requestBegin(area, frames, request->getParam("file")->value().c_str(), every);
+    }
+
+    response = request->beginResponseStream(F(kJSON_TYPE));
+    response->setCode(ok ? 200 : 400);
+    response->printf_P(PSTR("{ \"result\": \"%s\", \"recording\": %s, \"frames\": %u, \"bytes\": %u }"), ok ? "ok" : "failed",
+        gFrameRecorder.isRecording() ? "true" : "false", gFrameRecorder.recordedFrames(), gFrameRecorder.recordedBytes());
+    request->send(response);
+}
+
+// /$loadtest?mix=color:3,effect:1&areas=0,3&rate=10&duration=600 starts a load
+// test (see LoadTest.h), stop=1 ends it early and report=1 returns the report
+// from the last one. Otherwise reports test status.
+
+void ServerMgr::handleLoadTest(AsyncWebServerRequest *request) {
+    AsyncResponseStream *response;
+    bool                ok = true;
+
+    if (request->hasParam("report")) {
+        if (LittleFS.exists(kLOADTEST_REPORT_PATH)) {
+            request->send(LittleFS, kLOADTEST_REPORT_PATH, F(kJSON_TYPE));
+        }
+        else {
+            request->send(404, F(kJSON_TYPE), F("{ \"result\": \"no report\" }"));
+        }
+        return;
+    }
+
+    if (request->hasParam("stop")) {
+        gLoadTest.end();
+    }
+    else if (request->hasParam("mix") || request->hasParam("areas") || request->hasParam("rate") || request->hasParam("duration")) {
+        String  mix = request->hasParam("mix") ? request->getParam("mix")->value() : String();
+        String  areas = request->hasParam("areas") ? request->getParam("areas")->value() : String();
+        float   rate = request->hasParam("rate") ? request->getParam("rate")->value().toFloat() : 0.0;
+        float   duration = request->hasParam("duration") ? request->getParam("duration")->value().toFloat() : 0.0;
+
+        ok = gLoadTest.begin(mix.c_str(), areas.c_str(), rate, duration);
+    }
+
+    response = request->beginResponseStream(F(kJSON_TYPE));
+    response->printf_P(PSTR("{ \"result\": \"%s\", \"running\": %s, \"elapsed\": %u, \"commands\": %u }"), ok ? "ok" : "failed",
+        gLoadTest.isRunning() ? "true" : "false", gLoadTest.elapsed(), gLoadTest.issuedCount());
+    request->send(response);
+}
+
+// /$trace?record=/evening.klt starts recording inbound commands, replay=<file>
+// plays a trace back (speed=1 for recorded timing, 2 for twice as fast,
+// speed=fast or 0 for as fast as possible), stop=1 ends either and report=1
+// returns the last replay report. Starting and stopping only post a request
+// which the trace task carries out, so "ok" means it was accepted.
+
+void ServerMgr::handleTrace(AsyncWebServerRequest *request) {
+    AsyncResponseStream *response;
+    bool                ok = true;
+
+    if (request->hasParam("report")) {
+        if (LittleFS.exists(kTRACE_REPORT_PATH)) {
+            request->send(LittleFS, kTRACE_REPORT_PATH, F(kJSON_TYPE));
+        }
+        else {
+            request->send(404, F(kJSON_TYPE), F("{ \"result\": \"no report\" }"));
+        }
+        return;
+    }
+
+    if (request->hasParam("stop")) {
+        gCommandTrace.requestStop();
+    }
+    else if (request->hasParam("record")) {
+        ok = gCommandTrace.requestRecord(request->getParam("record")->value().c_str());
+    }
+    else if (request->hasParam("replay")) {
+        String  speed = request->hasParam("speed") ? request->getParam("speed")->value() : String("1");
+
+        ok = gCommandTrace.requestReplay(request->getParam("replay")->value().c_str(), speed == "fast" ? 0.0 : speed.toFloat());
+    }
+
+    response = request->beginResponseStream(F(kJSON_TYPE));
+    response->printf_P(PSTR("{ \"result\": \"%s\", \"recording\": %s, \"replaying\": %s, \"records\": %u }"), ok ? "ok" : "failed",
+        gCommandTrace.isRecording() ? "true" : "false", gCommandTrace.isReplaying() ? "true" : "false", gCommandTrace.recordCount());
+    request->send(response);
+}
+
+void ServerMgr::handleTasks(AsyncWebServerRequest *request) {
+    const SchedFrameStatsRec    &frame = gLoopScheduler.getFrameStats();
+    AsyncResponseStream         *response = request->beginResponseStream(F(kJSON_TYPE));
+
+    response->addHeader(F("Cache-Control"), F("no-cache"));
+    response->printf_P(PSTR("{ \"frame\": { \"frames\": %u, \"missed\": %u, \"avg\": %u, \"max\": %u, \"maxLate\": %u }, \"tasks\": ["),
+        frame.frames, frame.missed, frame.avgTime, frame.maxTime, frame.maxLate);
+
+    for (uint8_t tIdx=0; tIdx<gLoopScheduler.getTaskCount(); tIdx++) {
+        const SchedTaskRec  &task = gLoopScheduler.getTask(tIdx);
+
+        response->printf_P(PSTR("%s{ \"name\": \"%s\", \"budget\": %u, \"runs\": %u, \"avg\": %u, \"max\": %u, \"overruns\": %u, \"lateFrames\": %u }"),
+            tIdx ? ", " : "", task.name, task.budget, task.runs, task.avgTime, task.maxTime, task.overruns, task.lateFrames);
+    }
+    response->print(F("], "));
+
+    const RenderStatsRec    &render = gPixels->getRenderStats();
+
+    response->printf_P(PSTR("\"render\": { \"render\": %u, \"lerp\": %u, \"keyframes\": %u, \"lerpFrames\": %u, \"tickTime\": %u }, \"areas\": ["),
+        render.renderTime, render.lerpTime, render.keyframes, render.lerpFrames, gPixels->getFrameLoad());
+
+    for (uint16_t aIdx=0, count=0; aIdx<kMAX_PIXEL_AREAS; aIdx++) {
+        PixelAreaPtr    area = gPixels->getArea(aIdx);
+
+        if (area->len > 0) {
+            response->printf_P(PSTR("%s{ \"area\": %u, \"lod\": %u, \"render\": %u, \"nsPerPixel\": %u, \"effect\": %s }"),
+                count++ ? ", " : "", aIdx, area->lod, area->renderTime, area->renderTime * 1000 / area->len, area->effect != nullptr ? "true" : "false");
+        }
+    }
+    response->print(F("] }"));
+    request->send(response);
+}
+
+// POST /$commands takes a JSON array of area commands, each an "area" plus any
+// of the MQTT fields (state, color, brightness, transition, effect and its
+// parameters). The batch is checked as a whole and queued together, so every
+// command lands on the same tick, or none do. The response lists a result per
+// command, the time to parse and queue the batch and the worst case latency
+// until it is applied at the start of the next frame.
+//
+// The request must be sent as Content-Type: application/json. Form encoded
+// posts are parsed as parameters and never reach handleCommandsBody, so they
+// are turned away with a 415.
+//
+// [ { "area": 0, "state": "ON", "color": { "h": 30, "s": 80 }, "brightness": 60 },
+//   { "area": 1, "effect": "wave", "rate": 0.5, "width": 20 } ]
+
+void ServerMgr::handleCommandsBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    char    *body;
+
+    // The body arrives in pieces as it streams in, collect it (bounded) and
+    // parse it in place once it is all here
+    if (index == 0 && total <= kBATCH_MAX_BODY) {
+        request->_tempObject = malloc(total + 1);       // freed along with the request
+    }
+
+    if ((body = (char *)request->_tempObject) != nullptr && index + len <= total) {
+        memcpy(body + index, data, len);
+        if (index + len == total) {
+            body[total] = 0;
+        }
+    }
+}
+
+void ServerMgr::handleCommands(AsyncWebServerRequest *request) {
+    struct {
+        uint16_t    area;
+        const char  *result;
+    }                       results[kCMD_QUEUE_LEN];
+    uint32_t                start = micros();
+    char                    *body = (char *)request->_tempObject;
+    PixelCommandPtr         batch;
+    AsyncResponseStream     *response;
+    uint16_t                count = 0;
+    bool                    valid = true;
+    bool                    queued = false;
+    uint32_t                elapsed;
+    uint32_t                applyIn;
+
+    if (!request->contentType().startsWith(F("application/json"))) {
+        request->send(415, F(kJSON_TYPE), F("{ \"result\": \"send the commands as Content-Type: application/json\" }"));
+        return;
+    }
+
+    if (body == nullptr) {
+        request->send(413, F(kJSON_TYPE), F("{ \"result\": \"missing or too large\" }"));
+        return;
+    }
+
+    DynamicJsonDocument     jsonDoc(strlen(body) * 2 + 256);
+    DeserializationError    error = deserializeJson(jsonDoc, body);     // in place
+
+    if (error || !jsonDoc.is<JsonArray>() || jsonDoc.size() > kCMD_QUEUE_LEN) {
+        request->send(400, F(kJSON_TYPE), F("{ \"result\": \"expected an array of up to 16 commands\" }"));
+        return;
+    }
+
+    if ((batch = (PixelCommandPtr)malloc(sizeof(PixelCommandRec) * jsonDoc.size())) == nullptr) {
+        request->send(503, F(kJSON_TYPE), F("{ \"result\": \"out of memory\" }"));
+        return;
+    }
+
+    for (JsonVariantConst item : jsonDoc.as<JsonArrayConst>()) {
+        PixelCommandPtr cmd = &batch[count];
+        int             areaID = item["area"] | -1;
+
+        results[count].area = areaID;
+        results[count].result = "ok";
+        if (areaID < 0 || areaID >= kMAX_PIXEL_AREAS || gPixels->getArea(areaID)->len <= 0) {
+            results[count].result = "bad area";
+        }
+        else {
+            cmd->areaID = areaID;
+            PixelController::parseCommand(item, *cmd);
+            // checked first, an item with only a misspelled effect would otherwise look empty
+            if (item.containsKey("effect") && !(cmd->fields & cmd_effect) && strcmp(item["effect"] | "", "none")) {
+                results[count].result = "unknown effect";
+            }
+            else if (cmd->fields == 0) {
+                results[count].result = "nothing to do";
+            }
+        }
+        valid = valid && !strcmp(results[count].result, "ok");
+        count++;
+    }
+
+    if (valid && !(queued = gPixels->queueCommands(batch, count))) {
+        for (uint16_t i=0; i<count; i++) {
+            results[i].result = "queue full";
+        }
+    }
+    free(batch);
+
+    elapsed = micros() - start;
+    applyIn = gLoopScheduler.frameRemaining();
+
+    response = request->beginResponseStream(F(kJSON_TYPE));
+    response->setCode(queued ? 200 : valid ? 503 : 400);
+    response->printf_P(PSTR("{ \"result\": \"%s\", \"parse\": %u, \"applyIn\": %u, \"latency\": %u, \"commands\": ["),
+        queued ? "ok" : valid ? "queue full" : "rejected", elapsed, applyIn, elapsed + applyIn);
+    for (uint16_t i=0; i<count; i++) {
+        response->printf_P(PSTR("%s{ \"area\": %d, \"result\": \"%s\" }"), i ? ", " : "", (int16_t)results[i].area, results[i].result);
+    }
+    response->print(F("] }"));
+    request->send(response);
+}
+
+// Firmware arrives in chunks from the AsyncTCP callbacks and is written straight
+// to flash so the pixel ticker keeps running for the whole transfer. Images may
+// be gzip compressed (.bin.gz); Updater accepts them as is and eboot inflates
+// the image while copying it into place on the next boot. Progress is shown as
+// a bar on kOTA_PROGRESS_AREA while the other areas carry on as they were. If
+// the client goes away before handleUpdateDone the update is abandoned so the
+// next one can begin.
+
+void ServerMgr::handleUpdateUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
+    if (index == 0) {
+        uint32_t maxSketchSpace = (ESP.getFreeSketchSpace() - 0x1000) & 0xFFFFF000;
+
+        updateCompressed = len >= 2 && data[0] == 0x1f && data[1] == 0x8b;
+        // The multipart framing is counted too so the bar stops a little short
+        // of full until Update.end() succeeds
+        updateTotal = request->contentLength();
+        updateProgress = 0.0;
+        updateActive = true;
+        request->onDisconnect([this]() { this->handleUpdateDisconnect(); });
+
+        Serial.printf_P(PSTR("Update: %s (%s, ~%u bytes)\n"), filename.c_str(), updateCompressed ? "gzip" : "raw", updateTotal);
+        updateShowStart = true;     // the progress bar is put up from loop()
+
+        Update.runAsync(true);
+        if (!Update.begin(maxSketchSpace, U_FLASH)) {
+            Update.printError(Serial);
+        }
+    }
+
+    if (!Update.hasError() && len > 0) {
+        if (Update.write(data, len) != len) {
+            Update.printError(Serial);
+        }
+        if (updateTotal > 0) {
+            updateProgress = min(1.0f, (float)(index + len) / (float)updateTotal);
+        }
+    }
+
+    if (final) {
+        if (Update.end(true)) {
+            Serial.printf_P(PSTR("Update success: %u bytes\n"), index + len);
+            updateProgress = 1.0;
+        }
+        else {
+            Update.printError(Serial);
+        }
+    }
+}
+
+void ServerMgr::handleUpdateDone(AsyncWebServerRequest *request) {
+    bool    success = !Update.hasError();
+
+    updateActive = false;
+    request->send(200, F("text/plain"), success ? F("Update Success! Rebooting...") : F("Update Failed"));
+    if (success) {
+        restartTime = millis();     // give the response a chance to go out
+    }
+    else {
+        updateShowFailed = true;    // cleared up from loop()
+    }
+}
+
+// Called whenever an update request's client disconnects, which after
+// handleUpdateDone is the normal end of the request
+
+void ServerMgr::handleUpdateDisconnect() {
+    if (updateActive) {
+        updateActive = false;
+        if (Update.isRunning()) {
+            Update.end(false);      // not finished, so this discards it
+        }
+        Serial.println(F("Update abandoned, client disconnected"));
+        updateShowFailed = true;    // cleared up from loop()
     }
-    gPixels->handleWebCommand(jsonDoc);
-    server.send(200, F("application/json; charset=utf-8"), F("{ \"result\": \"ok\" }"));
 }
 
-void ServerMgr::handleBasicUpload() {
-    server.send(200, "text/html", FPSTR(uploadContent));
+void ServerMgr::handleBasicUpload(AsyncWebServerRequest *request) {
+    request->send_P(200, "text/html", uploadContent);
 }
 
 // Called on request without filename. This will redirect to the file 
 // index.html if it exists, otherwise to the built-in minup.html page
 
-void ServerMgr::handleRedirect() {
+void ServerMgr::handleRedirect(AsyncWebServerRequest *request) {
     String url(F("/index.html"));
 
-    if (!LittleFS.exists(url)) {
+    if (!LittleFS.exists(url) && !LittleFS.exists(url + F(".gz"))) {
         url = F("/minup.html");
     }
 
-    server.sendHeader("Location", url, true);
-    server.send(302);
+    request->redirect(url);
 }
 
-void ServerMgr::handleNotFound() {
-    server.send(404, "text/html", FPSTR(notFoundContent));
+void ServerMgr::handleNotFound(AsyncWebServerRequest *request) {
+    request->send_P(404, "text/html", notFoundContent);
 }
@@ -10,8 +10,10 @@
 #define ServerMgr_h
 
 #include <Arduino.h>
-#include <ESP8266WebServer.h>
-#include <ESP8266HTTPUpdateServer.h>
+#include <ESPAsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+
+#define kRESTART_DELAY      500
 
 class ServerMgr {
 public:
@@ -21,16 +23,32 @@ public:
     void loop();
 
 protected:
-    void handleFileList();
-    void handleSysInfo();
-    void handleEffect();
-    void handleBasicUpload();
-    void handleRedirect();
-    void handleNotFound();
+    void handleFileList(AsyncWebServerRequest *request);
+    void handleSysInfo(AsyncWebServerRequest *request);
+    void handleEffect(AsyncWebServerRequest *request);
+    void handlePlaylist(AsyncWebServerRequest *request);
+    void handleRecord(AsyncWebServerRequest *request);
+    void handleTasks(AsyncWebServerRequest *request);
+    void handleLoadTest(AsyncWebServerRequest *request);
+    void handleTrace(AsyncWebServerRequest *request);
+    void handleCommands(AsyncWebServerRequest *request);
+    void handleCommandsBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+    void handleUpdateUpload(AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final);
+    void handleUpdateDone(AsyncWebServerRequest *request);
+    void handleUpdateDisconnect();
+    void handleBasicUpload(AsyncWebServerRequest *request);
+    void handleRedirect(AsyncWebServerRequest *request);
+    void handleNotFound(AsyncWebServerRequest *request);
 
-    ESP8266WebServer        server;
-    ESP8266HTTPUpdateServer httpUpdater;
+    AsyncWebServer          server;
     time_t                  bootTime;
+    uint32_t                restartTime;
+    float                   updateProgress;
+    size_t                  updateTotal;
+    bool                    updateCompressed;
+    bool                    updateActive;       // from the first chunk until handleUpdateDone
+    bool                    updateShowStart;    // applied from loop()
+    bool                    updateShowFailed;
 };
 
 #endif
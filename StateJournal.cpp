@@ -0,0 +1,188 @@
+//
+//  StateJournal.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "StateJournal.h"
+#include "LoopScheduler.h"
+#include "config.h"
+#include <LittleFS.h>
+
+StateJournal gStateJournal;
+
+StateJournal::StateJournal() {
+    validMask = 0;
+    restoredMask = 0;
+    pendingMask = 0;
+    lastChange = 0;
+    recordCount = 0;
+}
+
+// Replay the journal. Later records supersede earlier ones and anything that
+// fails validation (e.g. a record torn by a power loss) is skipped.
+
+void StateJournal::restore(PixelController *controller) {
+    File        file = LittleFS.open(kJOURNAL_PATH, "r");
+    RecordRec   record;
+
+    if (!file) {
+        return;
+    }
+
+    while (file.read((uint8_t *)&record, sizeof(record)) == sizeof(record)) {
+        if (isValid(record)) {
+            lastRecords[record.areaID] = record;
+            validMask |= bit(record.areaID);
+        }
+        recordCount++;
+    }
+    file.close();
+
+    for (uint16_t aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++) {
+        if ((validMask & kJOURNAL_AREAS & bit(aIdx))) {
+            RecordPtr           recordP = &lastRecords[aIdx];
+            PixelAreaStateRec   state;
+
+            state.isOn = recordP->isOn;
+            state.color = SHSVRec(recordP->hue, recordP->sat, recordP->val);
+            state.effect = recordP->effect;
+            controller->restoreAreaState(aIdx, state);
+            restoredMask |= bit(aIdx);
+        }
+    }
+
+    Serial.printf_P(PSTR("Journal: %d records, restored 0x%x\n"), recordCount, restoredMask);
+}
+
+void StateJournal::loop() {
+    uint32_t    now = millis();
+
+    for (uint16_t aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++) {
+        if ((kJOURNAL_AREAS & bit(aIdx)) && gPixels->getUpdatedJournalState(aIdx, pending[aIdx])) {
+            pendingMask |= bit(aIdx);
+            lastChange = now;
+        }
+    }
+
+    if (pendingMask && now - lastChange > kJOURNAL_DEBOUNCE) {
+        for (uint16_t aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++) {
+            if (pendingMask & bit(aIdx)) {
+                PixelAreaStatePtr   stateP = &pending[aIdx];
+                RecordRec           record;
+
+                memset(&record, 0, sizeof(record));
+                record.magic = kJOURNAL_MAGIC;
+                record.recLen = sizeof(RecordRec);
+                record.areaID = aIdx;
+                record.isOn = stateP->isOn;
+                record.hue = stateP->color.hue;
+                record.sat = stateP->color.sat;
+                record.val = stateP->color.val;
+                record.effect = cleanSpec(stateP->effect);
+                record.check = checksum(record);
+
+                // Skip writes that wouldn't change anything (e.g. MQTT restore)
+                if (!(validMask & bit(aIdx)) || memcmp(&record, &lastRecords[aIdx], sizeof(record))) {
+                    append(record);
+                }
+                pendingMask &= ~bit(aIdx);
+
+                if (gLoopScheduler.shouldYield()) {
+                    return;     // the rest on the next slice
+                }
+            }
+        }
+    }
+
+    if (!pendingMask && recordCount >= kJOURNAL_MAX_RECORDS && !gLoopScheduler.shouldYield()) {
+        compact();
+    }
+}
+
+// Specs are built on the stack without being cleared, so copy only the fields
+// that mean something into a zeroed one. Padding and the unused tail of the
+// path / stops union stay zero and the memcmp above only sees real changes.
+
+PxlFXSpecRec StateJournal::cleanSpec(const PxlFXSpecRec &src) {
+    PxlFXSpecRec    dst;
+
+    memset(&dst, 0, sizeof(dst));
+    if (src.type == fx_none) {
+        return dst;     // plain color, nothing else in the spec is used
+    }
+
+    dst.type = src.type;
+    dst.flags = src.flags;
+    dst.rate = src.rate;
+    dst.width = src.width;
+    dst.duration = src.duration;
+
+    if (src.type == fx_gradient) {
+        dst.gradient.count = min(src.gradient.count, (uint8_t)kFX_MAX_STOPS);
+        memcpy(dst.gradient.stops, src.gradient.stops, sizeof(FXStopRec) * dst.gradient.count);
+    }
+    else if (src.type == fx_playback) {
+        strncpy(dst.path, src.path, sizeof(dst.path) - 1);     // bounded even if src wasn't terminated
+    }
+
+    return dst;
+}
+
+void StateJournal::append(const RecordRec &record) {
+    File    file = LittleFS.open(kJOURNAL_PATH, "a");
+
+    if (file) {
+        file.write((const uint8_t *)&record, sizeof(record));
+        file.close();
+
+        lastRecords[record.areaID] = record;
+        validMask |= bit(record.areaID);
+        recordCount++;
+    }
+}
+
+// Write the latest record for each area to a temp file and rename it over the
+// journal. If we lose power part way the old journal is still intact.
+
+void StateJournal::compact() {
+    File        file = LittleFS.open(kJOURNAL_TEMP_PATH, "w");
+    uint16_t    count = 0;
+
+    if (!file) {
+        return;
+    }
+
+    for (uint16_t aIdx=0; aIdx<kMAX_PIXEL_AREAS; aIdx++) {
+        if (validMask & bit(aIdx)) {
+            file.write((const uint8_t *)&lastRecords[aIdx], sizeof(RecordRec));
+            count++;
+        }
+    }
+    file.close();
+
+    if (LittleFS.rename(kJOURNAL_TEMP_PATH, kJOURNAL_PATH)) {
+        recordCount = count;
+    }
+}
+
+uint16_t StateJournal::checksum(const RecordRec &record) {
+    const uint8_t   *data = (const uint8_t *)&record;
+    uint16_t        sum1 = 0;
+    uint16_t        sum2 = 0;
+
+    // Fletcher-16 over everything but the check field itself
+    for (size_t i=0; i<sizeof(RecordRec) - sizeof(record.check); i++) {
+        sum1 = (sum1 + data[i]) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+
+    return (sum2 << 8) | sum1;
+}
+
+bool StateJournal::isValid(const RecordRec &record) {
+    return record.magic == kJOURNAL_MAGIC && record.recLen == sizeof(RecordRec) &&
+        record.areaID < kMAX_PIXEL_AREAS && record.check == checksum(record);
+}
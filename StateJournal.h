@@ -0,0 +1,66 @@
+//
+//  StateJournal.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef StateJournal_h
+#define StateJournal_h
+
+#include "PixelController.h"
+
+// Keeps the last state of each persisted area in a small append-only binary
+// journal on LittleFS so it can be replayed at boot before any networking. 
+// Changes are debounced so a burst of commands costs one write and the journal
+// is compacted down to one record per area once it grows past a limit. Appends
+// plus LittleFS's own block wear leveling keep flash wear low.
+
+#define kJOURNAL_PATH           "/state.jnl"
+#define kJOURNAL_TEMP_PATH      "/state.tmp"
+#define kJOURNAL_MAGIC          0x4A4B      // "KJ"
+#define kJOURNAL_DEBOUNCE       3000
+#define kJOURNAL_MAX_RECORDS    64
+
+class StateJournal {
+public:
+    StateJournal();
+
+    void restore(PixelController *controller);
+    void loop();
+
+    inline bool didRestore(uint16_t areaID) { return restoredMask & bit(areaID); }
+
+private:
+    typedef struct __attribute__((__packed__)) {
+        uint16_t        magic;
+        uint8_t         recLen;     // guards against layout changes between builds
+        uint8_t         areaID;
+        uint8_t         isOn;
+        float           hue;
+        float           sat;
+        float           val;
+        PxlFXSpecRec    effect;
+        uint16_t        check;
+    } RecordRec, *RecordPtr;
+
+    static PxlFXSpecRec cleanSpec(const PxlFXSpecRec &src);
+    static uint16_t checksum(const RecordRec &record);
+    static bool isValid(const RecordRec &record);
+
+    void append(const RecordRec &record);
+    void compact();
+
+    RecordRec       lastRecords[kMAX_PIXEL_AREAS];
+    uint32_t        validMask;
+    uint32_t        restoredMask;
+    PixelAreaStateRec pending[kMAX_PIXEL_AREAS];
+    uint32_t        pendingMask;
+    uint32_t        lastChange;
+    uint16_t        recordCount;
+};
+
+extern StateJournal gStateJournal;
+
+#endif
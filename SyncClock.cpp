@@ -0,0 +1,139 @@
+//
+//  SyncClock.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "SyncClock.h"
+#include "config.h"
+#include <ESP8266WiFi.h>
+#include <sys/time.h>
+
+SyncClock gSyncClock;
+
+SyncClock::SyncClock() {
+    listening = false;
+    nodeID = ESP.getChipId();
+    leaderID = nodeID;
+    leaderSeen = 0;
+    lastBeacon = 0;
+    lastSlew = 0;
+    hasTarget = false;
+    target = 0;
+    offset = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void SyncClock::loop() {
+    uint64_t    localTime = micros64();
+    bool        wifiUp = WiFi.status() == WL_CONNECTED;
+
+    if (wifiUp && !listening) {
+        listening = udp.begin(kSYNC_PORT);
+    }
+
+    if (wifiUp && listening) {
+        receiveBeacons(localTime);
+    }
+
+    if (leaderID != nodeID && localTime - leaderSeen > kSYNC_LEADER_TIMEOUT * 1000ULL) {
+        Serial.println(F("Sync leader lost"));
+        leaderID = nodeID;
+    }
+
+    if (localTime - lastBeacon >= kSYNC_BEACON_INTERVAL * 1000ULL) {
+        if (leaderID == nodeID) {
+            sampleNTP(localTime);
+        }
+        if (wifiUp && listening) {
+            sendBeacon(localTime);
+        }
+        lastBeacon = localTime;
+    }
+
+    slew(localTime);
+}
+
+const SyncStatsRec &SyncClock::getStats() {
+    stats.leaderID = leaderID;
+    stats.isLeader = leaderID == nodeID;
+    stats.error = hasTarget ? (int32_t)(target - offset) : 0;
+
+    return stats;
+}
+
+void SyncClock::sample(int64_t sampleOffset) {
+    int64_t     diff = sampleOffset - target;
+
+    if (!hasTarget || llabs(diff) > kSYNC_STEP_US) {
+        target = sampleOffset;
+        hasTarget = true;
+    }
+    else {
+        target += diff / (1 << kSYNC_FILTER_SHIFT);
+    }
+}
+
+void SyncClock::slew(uint64_t localTime) {
+    int64_t     diff = target - offset;
+    int64_t     maxAdjust;
+
+    if (hasTarget && diff != 0) {
+        if (llabs(diff) > kSYNC_STEP_US) {
+            offset = target;
+            stats.steps++;
+        }
+        else {
+            maxAdjust = (int64_t)(localTime - lastSlew) * kSYNC_SLEW_PPM / 1000000;
+            if (maxAdjust > 0) {
+                offset += diff > 0 ? min(diff, maxAdjust) : max(diff, -maxAdjust);
+            }
+            else {
+                return;     // let elapsed time accumulate
+            }
+        }
+    }
+    lastSlew = localTime;
+}
+
+void SyncClock::receiveBeacons(uint64_t localTime) {
+    BeaconRec   beacon;
+
+    while (udp.parsePacket() > 0) {
+        if (udp.read((uint8_t *)&beacon, sizeof(beacon)) == sizeof(beacon) && beacon.magic == kSYNC_MAGIC && beacon.nodeID != nodeID) {
+            if (beacon.nodeID <= leaderID) {
+                if (beacon.nodeID != leaderID) {
+                    Serial.printf_P(PSTR("Sync leader: %08x\n"), beacon.nodeID);
+                    leaderID = beacon.nodeID;
+                }
+                leaderSeen = localTime;
+                stats.beacons++;
+                sample((int64_t)beacon.syncTime - (int64_t)localTime);
+            }
+        }
+        udp.flush();
+    }
+}
+
+void SyncClock::sendBeacon(uint64_t localTime) {
+    BeaconRec   beacon;
+
+    beacon.magic = kSYNC_MAGIC;
+    beacon.nodeID = nodeID;
+    beacon.syncTime = (uint64_t)((int64_t)localTime + offset);
+
+    udp.beginPacket(WiFi.broadcastIP(), kSYNC_PORT);
+    udp.write((const uint8_t *)&beacon, sizeof(beacon));
+    udp.endPacket();
+}
+
+void SyncClock::sampleNTP(uint64_t localTime) {
+    struct timeval  tv;
+
+    gettimeofday(&tv, NULL);
+    if (tv.tv_sec >= kEPOCH_01012022) {
+        sample((int64_t)tv.tv_sec * 1000000LL + tv.tv_usec - (int64_t)localTime);
+    }
+}
@@ -0,0 +1,84 @@
+//
+//  SyncClock.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef SyncClock_h
+#define SyncClock_h
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+// A wall clock (ms since the epoch) that all nodes on the LAN agree on so
+// effects started with the same parameters render the same phase everywhere.
+//
+// Every node broadcasts a small beacon with its synced time once a second. The
+// node with the lowest chip ID heard recently is the leader; it steers its
+// clock toward NTP time, everyone else steers toward the leader's beacons.
+// Samples are smoothed and the applied offset is slewed (small errors) or
+// stepped (large ones) so effects never visibly jump once running. Beacons are
+// one-way so followers trail the leader by the LAN latency, typically well
+// under a frame.
+//
+// The local time base is micros64() which, unlike the system time, never
+// jumps when SNTP updates.
+
+#define kSYNC_PORT              4210
+#define kSYNC_MAGIC             0x4353          // "SC"
+#define kSYNC_BEACON_INTERVAL   1000            // mS
+#define kSYNC_LEADER_TIMEOUT    5000            // mS
+#define kSYNC_STEP_US           250000          // errors larger than this are stepped
+#define kSYNC_SLEW_PPM          5000            // otherwise corrected at 0.5%
+#define kSYNC_FILTER_SHIFT      2               // samples move the target 1/4 of the way
+
+typedef struct {
+    uint32_t    leaderID;
+    bool        isLeader;
+    int32_t     error;          // µS, target - applied offset
+    uint32_t    beacons;        // received from the leader
+    uint32_t    steps;          // offset corrections too large to slew
+} SyncStatsRec, *SyncStatsPtr;
+
+class SyncClock {
+public:
+    SyncClock();
+
+    void loop();
+
+    inline uint64_t now() { return (uint64_t)((int64_t)micros64() + offset) / 1000; }
+    const SyncStatsRec &getStats();
+
+    // Exposed so the sync logic can be driven without a network
+    void sample(int64_t sampleOffset);
+    void slew(uint64_t localTime);
+
+private:
+    typedef struct __attribute__((__packed__)) {
+        uint16_t    magic;
+        uint32_t    nodeID;
+        uint64_t    syncTime;   // µS, sender's synced time
+    } BeaconRec, *BeaconPtr;
+
+    void receiveBeacons(uint64_t localTime);
+    void sendBeacon(uint64_t localTime);
+    void sampleNTP(uint64_t localTime);
+
+    WiFiUDP         udp;
+    bool            listening;
+    uint32_t        nodeID;
+    uint32_t        leaderID;
+    uint64_t        leaderSeen;
+    uint64_t        lastBeacon;
+    uint64_t        lastSlew;
+    bool            hasTarget;
+    int64_t         target;         // µS to add to micros64()
+    int64_t         offset;         // applied, slews toward target
+    SyncStatsRec    stats;
+};
+
+extern SyncClock gSyncClock;
+
+#endif
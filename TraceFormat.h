@@ -0,0 +1,50 @@
+//
+//  TraceFormat.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef TraceFormat_h
+#define TraceFormat_h
+
+#include <stdint.h>
+
+// The command trace file format (see CommandTrace.h), kept free of the ESP8266
+// core so host tools can read traces too (see tools/trace_dump.cpp).
+//
+// TraceHeaderRec followed by recordCount records. Each record is a
+// TraceRecordRec followed by topicLen bytes of topic (MQTT only, no
+// terminator) and payloadLen bytes of payload. /$effect payloads are the
+// request's parameters as a JSON object, as handed to handleWebCommand.
+// Everything is little endian, as written by the ESP8266.
+
+#define kTRACE_MAGIC            0x52544C4B      // "KLTR"
+#define kTRACE_VERSION          1
+#define kTRACE_MAX_TOPIC        64
+#define kTRACE_MAX_PAYLOAD      512
+
+enum {
+    trace_mqtt = 0,     // topic and payload, replayed through NetworkMgr::mqttMonitor
+    trace_restore,      // retained state, replayed through PixelController::handleMQTTCommand
+    trace_web,          // /$effect parameters, replayed through PixelController::handleWebCommand
+    trace_source_count
+};
+
+typedef struct __attribute__((__packed__)) {
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    reserved;
+    uint32_t    recordCount;
+    uint32_t    duration;       // mS
+} TraceHeaderRec, *TraceHeaderPtr;
+
+typedef struct __attribute__((__packed__)) {
+    uint32_t    time;           // mS since recording began
+    uint8_t     source;
+    uint8_t     topicLen;
+    uint16_t    payloadLen;
+} TraceRecordRec, *TraceRecordPtr;
+
+#endif
@@ -0,0 +1,101 @@
+//
+//  UploadStager.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#include "UploadStager.h"
+
+void UploadStager::begin(UploadStatePtr state) {
+    static uint16_t uploadCount = 0;
+
+    snprintf_P(state->tempPath, sizeof(state->tempPath), PSTR(kUPLOAD_TEMP_PREFIX "%04x"), uploadCount++);
+    state->startTime = millis();
+    state->totalBytes = 0;
+    state->fileCount = 0;
+    state->used = 0;
+    state->fileFailed = false;
+    state->failed = false;
+}
+
+void UploadStager::beginFile(UploadStatePtr state, File &file, const char *name) {
+    snprintf_P(state->destPath, sizeof(state->destPath), PSTR("%s%s"), *name == '/' ? "" : "/", name);
+    state->used = 0;
+    state->fileFailed = false;
+    file = LittleFS.open(state->tempPath, "w");
+    if (!file) {
+        state->fileFailed = state->failed = true;
+    }
+}
+
+void UploadStager::append(UploadStatePtr state, File &file, const uint8_t *data, size_t len) {
+    while (len > 0 && file) {
+        size_t  count = min(len, (size_t)(kUPLOAD_BUF_LEN - state->used));
+
+        memcpy(state->buffer + state->used, data, count);
+        state->used += count;
+        data += count;
+        len -= count;
+        if (state->used == kUPLOAD_BUF_LEN) {
+            flush(state, file);
+        }
+    }
+}
+
+void UploadStager::flush(UploadStatePtr state, File &file) {
+    if (state->used > 0 && file) {
+        if (file.write(state->buffer, state->used) != state->used) {
+            state->fileFailed = true;
+        }
+        state->totalBytes += state->used;
+        state->used = 0;
+    }
+}
+
+void UploadStager::finishFile(UploadStatePtr state, File &file) {
+    if (!file) {
+        return;
+    }
+
+    flush(state, file);
+    file.close();
+    if (!state->fileFailed && LittleFS.rename(state->tempPath, state->destPath)) {
+        state->fileCount++;
+    }
+    else {
+        Serial.print(F("Upload failed: ")); Serial.println(state->destPath);
+        LittleFS.remove(state->tempPath);
+        state->failed = true;
+    }
+}
+
+// Removing an entry while a Dir is walking its directory shifts the entries
+// after it, so names are gathered a batch at a time and removed once the walk
+// is done.
+
+void UploadStager::removeStale() {
+    String      prefix = F(kUPLOAD_TEMP_PREFIX);
+    char        names[kUPLOAD_STALE_BATCH][kUPLOAD_TEMP_LEN];
+    uint16_t    count, removed;
+
+    do {
+        Dir     dir = LittleFS.openDir("/");
+
+        count = removed = 0;
+        while (count < kUPLOAD_STALE_BATCH && dir.next()) {
+            String  path = "/" + dir.fileName();
+
+            if (path.startsWith(prefix) && path.length() < kUPLOAD_TEMP_LEN) {
+                strcpy(names[count++], path.c_str());
+            }
+        }
+
+        for (uint16_t nIdx=0; nIdx<count; nIdx++) {
+            if (LittleFS.remove(names[nIdx])) {
+                removed++;
+            }
+        }
+    } while (count == kUPLOAD_STALE_BATCH && removed == count);    // a full batch may have left more behind
+}
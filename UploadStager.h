@@ -0,0 +1,54 @@
+//
+//  UploadStager.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef UploadStager_h
+#define UploadStager_h
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// Uploads are staged through a page aligned buffer into a temp file which only
+// replaces the destination (LittleFS renames atomically) once the whole file
+// has arrived. An interrupted transfer leaves the old file in place, and a temp
+// file left over by one is swept up at startup.
+//
+// The state is plain data so it can live in a request's _tempObject (which is
+// released with free()). The file is passed in separately.
+
+#define kUPLOAD_BUF_LEN         1024        // a multiple of the LittleFS page size (256) so writes are whole pages
+#define kUPLOAD_TEMP_PREFIX     "/.up"
+#define kUPLOAD_TEMP_LEN        16
+#define kUPLOAD_DEST_LEN        72
+#define kUPLOAD_STALE_BATCH     8
+
+typedef struct {
+    char        tempPath[kUPLOAD_TEMP_LEN];
+    char        destPath[kUPLOAD_DEST_LEN];
+    uint32_t    startTime;
+    uint32_t    totalBytes;
+    uint16_t    fileCount;
+    uint16_t    used;
+    bool        fileFailed;     // current file
+    bool        failed;         // any file
+    uint8_t     buffer[kUPLOAD_BUF_LEN];
+} UploadStateRec, *UploadStatePtr;
+
+class UploadStager {
+public:
+    static void begin(UploadStatePtr state);
+    static void beginFile(UploadStatePtr state, File &file, const char *name);
+    static void append(UploadStatePtr state, File &file, const uint8_t *data, size_t len);
+    static void finishFile(UploadStatePtr state, File &file);
+
+    static void removeStale();
+
+protected:
+    static void flush(UploadStatePtr state, File &file);
+};
+
+#endif
@@ -25,13 +25,29 @@
 #define kMQTT_CLIENT    "klights_mcu_test"
 #define kPROJ_TITLE     "TestLights"
 #define kMQTT_ENDPOINT  "home/lights/test"
+#define kOTA_PROGRESS_AREA  area_main
+#define kPOWER_BUDGET_MA    2000
 #else
 #undef BENCH_TEST
 #define kMQTT_CLIENT    "klights_mcu"
 #define kPROJ_TITLE     "KLights"
 #define kMQTT_ENDPOINT  "home/lights/kitchen"
+#define kOTA_PROGRESS_AREA  area_coffee
+#define kPOWER_BUDGET_MA    8000
 #endif
 
+// Output power limiting (see PowerLimiter.h). The budget is what the supply can
+// deliver to the strips, 0 disables limiting. Channel values are typical draw
+// per channel at full scale for SK6812 RGBW, idle is per pixel with all
+// channels off.
+#define kPOWER_MA_G         12
+#define kPOWER_MA_R         12
+#define kPOWER_MA_B         12
+#define kPOWER_MA_W         16
+#define kPOWER_IDLE_MA      1
+
+#define kEPOCH_01012022     1640995200      // anything earlier means we don't have NTP time yet
+
 enum {
     area_main = 0,
     area_status_1,
@@ -39,4 +55,8 @@ enum {
     area_coffee,
 };
 
+// Areas whose state is kept in the state journal. The status areas just
+// reflect connectivity so there's no point persisting them.
+#define kJOURNAL_AREAS      ((1UL << area_main) | (1UL << area_coffee))
+
 #endif
@@ -0,0 +1,103 @@
+//
+//  espshow.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 04/17/2022.
+//  Copyright © 2022 Casey Fleser. All rights reserved.
+//
+//  Adapated from Adafruit_NeoPixel library
+
+#include <Arduino.h>
+#include <eagle_soc.h>
+#include "LEDChips.h"
+
+// The show routine is a template over the chip's bit timings and output pixel
+// format so each supported chip gets its own specialized loop with the timings
+// as immediate constants and no per-byte format checks. espShow picks the 
+// instantiation once per strip.
+//
+// At 80MHz each cycle is 12.5nS and the data sheet timings allow edge errors
+// of ±0.15μs (SK6812) which allows our timing to slip as much as ±12 cycles.
+
+template <class Chip>
+static IRAM_ATTR void espShowChip(uint8_t pin, const SPixelRec *pixels, uint16_t numPixels, uint16_t scale) {
+    uint32_t        pinMask = bit(pin);
+    uint32_t        t, c, startTime;
+    uint8_t         bytes[4];
+
+    startTime = 0;
+    for (uint16_t pIdx=0; pIdx<numPixels; pIdx++, pixels++) {
+        const uint8_t   *src = (const uint8_t *)pixels;
+
+        // Resolved at compile time: reorder (and for RGB chips fold white in).
+        // This all happens during the low period of the last bit sent.
+        for (uint8_t bIdx=0; bIdx<Chip::Format::bytes; bIdx++) {
+            uint16_t    value = src[Chip::Format::offset(bIdx)];
+
+            if (Chip::Format::foldWhite) {
+                value = min((uint16_t)255, (uint16_t)(value + pixels->comp.w));
+            }
+            bytes[bIdx] = (value * scale) >> 8;         // power limiting
+        }
+
+        for (uint8_t bIdx=0; bIdx<Chip::Format::bytes; bIdx++) {
+            uint8_t     mask = 0x80;
+            uint8_t     value = bytes[bIdx];
+
+            do {
+                t = (value & mask) ? Chip::Timing::t1h : Chip::Timing::t0h;
+                while (((c = esp_get_cycle_count()) - startTime) < Chip::Timing::period);  // Wait for prior low to finish
+                GPIO_REG_WRITE(GPIO_OUT_W1TS_ADDRESS, pinMask);                             // Set high
+
+                startTime = c;                                                              // Save start time
+                while (((c = esp_get_cycle_count()) - startTime) < t);                      // Wait for high period to finish
+                GPIO_REG_WRITE(GPIO_OUT_W1TC_ADDRESS, pinMask);                             // Set low
+                mask >>= 1;
+            } while (mask);
+        }
+    }
+
+    while ((esp_get_cycle_count() - startTime) < Chip::Timing::period);                     // Wait for prior low to finish
+}
+
+template <class Chip>
+static IRAM_ATTR void espClearChip(uint8_t pin, uint16_t numPixels) {
+    uint32_t    numBits = numPixels * Chip::Format::bytes * 8;
+    uint32_t    pinMask = bit(pin);
+    uint32_t    c, startTime;
+
+    startTime = 0;
+    for (uint32_t i=0; i<numBits; i++) {
+        while (((c = esp_get_cycle_count()) - startTime) < Chip::Timing::period);  // Wait for prior low to finish
+        GPIO_REG_WRITE(GPIO_OUT_W1TS_ADDRESS, pinMask);                             // Set high
+
+        startTime = c;                                                              // Save start time
+        while (((c = esp_get_cycle_count()) - startTime) < Chip::Timing::t0h);      // Wait for high period to finish
+        GPIO_REG_WRITE(GPIO_OUT_W1TC_ADDRESS, pinMask);                             // Set low
+    }
+    while ((esp_get_cycle_count() - startTime) < Chip::Timing::period);             // Wait for prior low to finish
+}
+
+IRAM_ATTR void espShow(uint8_t chip, uint8_t pin, const SPixelRec *pixels, uint16_t numPixels, uint16_t scale) {
+    switch (chip) {
+#if SUPPORT_SK6812_GRBW == 1
+        case strip_sk6812_grbw:     espShowChip<Chip_SK6812_GRBW>(pin, pixels, numPixels, scale); break;
+#endif
+#if SUPPORT_WS2812_GRB == 1
+        case strip_ws2812_grb:      espShowChip<Chip_WS2812_GRB>(pin, pixels, numPixels, scale); break;
+#endif
+        default:                    break;
+    }
+}
+
+IRAM_ATTR void espClear(uint8_t chip, uint8_t pin, uint16_t numPixels) {
+    switch (chip) {
+#if SUPPORT_SK6812_GRBW == 1
+        case strip_sk6812_grbw:     espClearChip<Chip_SK6812_GRBW>(pin, numPixels); break;
+#endif
+#if SUPPORT_WS2812_GRB == 1
+        case strip_ws2812_grb:      espClearChip<Chip_WS2812_GRB>(pin, numPixels); break;
+#endif
+        default:                    break;
+    }
+}
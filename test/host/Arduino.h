@@ -0,0 +1,89 @@
+//
+//  Arduino.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef Host_Arduino_h
+#define Host_Arduino_h
+
+// Just enough of the ESP8266 Arduino core to build the hardware independent
+// modules on a Linux host. Time and the chip ID come from globals the test
+// sets, so one process can stand in for several nodes.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+#define F(s)                s
+#define PSTR(s)             s
+#define snprintf_P          snprintf
+#define bit(b)              (1UL << (b))
+#define constrain(v, lo, hi) ((v) < (lo) ? (lo) : ((v) > (hi) ? (hi) : (v)))
+
+typedef uint8_t byte;
+typedef char __FlashStringHelper;
+
+inline uint64_t hostMicros = 0;         // the current node's local time base
+inline uint32_t hostChipID = 0;
+inline bool     hostQuiet = true;       // drop Serial output
+
+inline uint64_t micros64() { return hostMicros; }
+inline uint32_t micros() { return (uint32_t)hostMicros; }
+inline uint32_t millis() { return (uint32_t)(hostMicros / 1000); }
+
+class HostSerial {
+public:
+    template <typename T> void print(const T &value) { if (!hostQuiet) { printValue(value); } }
+    template <typename T> void println(const T &value) { if (!hostQuiet) { printValue(value); putchar('\n'); } }
+
+    int printf_P(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        int     result = 0;
+
+        if (!hostQuiet) {
+            va_start(args, format);
+            result = vprintf(format, args);
+            va_end(args);
+        }
+
+        return result;
+    }
+
+private:
+    void printValue(const char *value) { fputs(value, stdout); }
+    void printValue(const std::string &value) { fputs(value.c_str(), stdout); }
+    void printValue(long value) { printf("%ld", value); }
+};
+
+inline HostSerial Serial;
+
+class HostESP {
+public:
+    uint32_t getChipId() { return hostChipID; }
+};
+
+inline HostESP ESP;
+
+// Arduino's String as far as the modules under test use it
+class String : public std::string {
+public:
+    String() { }
+    String(const char *str) : std::string(str) { }
+    String(const std::string &str) : std::string(str) { }
+
+    bool startsWith(const String &prefix) const { return compare(0, prefix.size(), prefix) == 0; }
+};
+
+inline String operator+(const char *lhs, const String &rhs) { return String(lhs + (const std::string &)rhs); }
+
+#endif
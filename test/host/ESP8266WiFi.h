@@ -0,0 +1,27 @@
+//
+//  ESP8266WiFi.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef Host_ESP8266WiFi_h
+#define Host_ESP8266WiFi_h
+
+#include "Arduino.h"
+#include "WiFiUdp.h"
+
+#define WL_CONNECTED        3
+
+inline bool hostWiFiUp = true;
+
+class HostWiFi {
+public:
+    int status() { return hostWiFiUp ? WL_CONNECTED : 0; }
+    IPAddress broadcastIP() { return IPAddress(); }
+};
+
+inline HostWiFi WiFi;
+
+#endif
@@ -0,0 +1,115 @@
+//
+//  LittleFS.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef Host_LittleFS_h
+#define Host_LittleFS_h
+
+#include "Arduino.h"
+#include <map>
+#include <memory>
+#include <vector>
+
+// A flat, RAM backed LittleFS. Like littlefs, written data only lands in the
+// file when it is closed, rename() replaces an existing destination in one
+// step, and a Dir walks the live directory by position so removing an entry
+// mid-walk makes it skip the one after. hostFSFree limits how many more bytes
+// can be written, to stand in for a full or failing flash.
+
+typedef std::vector<uint8_t>    HostFileData;
+
+inline std::map<std::string, HostFileData>  hostFiles;
+inline size_t                               hostFSFree = SIZE_MAX;
+
+class File {
+public:
+    File() { }
+
+    operator bool() const { return (bool)path; }
+
+    size_t write(const uint8_t *data, size_t len) {
+        size_t  count = path ? min(len, hostFSFree) : 0;
+
+        pending.insert(pending.end(), data, data + count);
+        hostFSFree -= count;
+
+        return count;
+    }
+
+    void close() {
+        if (path) {
+            hostFiles[*path] = pending;
+            path.reset();
+            pending.clear();
+        }
+    }
+
+    // Drops the file without committing, as a power loss would
+    void abandon() { path.reset(); pending.clear(); }
+
+private:
+    friend class HostLittleFS;
+
+    std::shared_ptr<std::string>    path;
+    HostFileData                    pending;
+};
+
+class Dir {
+public:
+    bool next() {
+        auto    entry = hostFiles.begin();
+
+        if (position >= hostFiles.size()) {
+            return false;
+        }
+        std::advance(entry, position++);
+        name = entry->first.substr(1);
+
+        return true;
+    }
+
+    String fileName() { return name; }
+
+private:
+    size_t      position = 0;
+    String      name;
+};
+
+class HostLittleFS {
+public:
+    File open(const String &path, const char *mode) {     // write only, all the tests need
+        File    file;
+
+        if (*mode == 'w') {
+            file.path = std::make_shared<std::string>(path);
+            hostFiles[path].clear();
+        }
+
+        return file;
+    }
+
+    bool exists(const String &path) { return hostFiles.count(path) != 0; }
+    bool remove(const String &path) { return hostFiles.erase(path) != 0; }
+
+    bool rename(const String &from, const String &to) {
+        auto    entry = hostFiles.find(from);
+
+        if (entry == hostFiles.end()) {
+            return false;
+        }
+        hostFiles[to] = entry->second;
+        hostFiles.erase(from);
+
+        return true;
+    }
+
+    Dir openDir(const String &path) { return Dir(); }
+};
+
+inline HostLittleFS LittleFS;
+
+#endif
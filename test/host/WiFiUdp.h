@@ -0,0 +1,101 @@
+//
+//  WiFiUdp.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef Host_WiFiUdp_h
+#define Host_WiFiUdp_h
+
+#include "Arduino.h"
+#include <deque>
+#include <vector>
+
+// A broadcast-only LAN. Every packet sent goes to every other socket that has
+// called begin(), arriving hostLatency µS of true (simulated) time later.
+
+inline uint64_t hostTime = 0;           // true time, µS
+inline uint32_t hostLatency = 300;
+
+class IPAddress { };
+
+class WiFiUDP {
+public:
+    ~WiFiUDP() { stop(); }
+
+    uint8_t begin(uint16_t port) {
+        stop();
+        sockets().push_back(this);
+        return 1;
+    }
+
+    void stop() {
+        std::vector<WiFiUDP *>  &list = sockets();
+
+        list.erase(std::remove(list.begin(), list.end(), this), list.end());
+        inbox.clear();
+    }
+
+    int parsePacket() {
+        current.clear();
+        readPos = 0;
+        if (!inbox.empty() && inbox.front().arrival <= hostTime) {
+            current = inbox.front().data;
+            inbox.pop_front();
+        }
+
+        return (int)current.size();
+    }
+
+    int read(uint8_t *buffer, size_t len) {
+        size_t  count = min(len, current.size() - readPos);
+
+        memcpy(buffer, current.data() + readPos, count);
+        readPos += count;
+
+        return (int)count;
+    }
+
+    void flush() { current.clear(); }
+
+    int beginPacket(IPAddress ip, uint16_t port) {
+        outgoing.clear();
+        return 1;
+    }
+
+    size_t write(const uint8_t *data, size_t len) {
+        outgoing.insert(outgoing.end(), data, data + len);
+        return len;
+    }
+
+    int endPacket() {
+        for (WiFiUDP *socket : sockets()) {
+            if (socket != this) {
+                socket->inbox.push_back({ hostTime + hostLatency, outgoing });
+            }
+        }
+
+        return 1;
+    }
+
+private:
+    typedef struct {
+        uint64_t                arrival;
+        std::vector<uint8_t>    data;
+    } PacketRec;
+
+    static std::vector<WiFiUDP *> &sockets() {
+        static std::vector<WiFiUDP *>   list;
+
+        return list;
+    }
+
+    std::deque<PacketRec>   inbox;
+    std::vector<uint8_t>    current;
+    std::vector<uint8_t>    outgoing;
+    size_t                  readPos = 0;
+};
+
+#endif
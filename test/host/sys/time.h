@@ -0,0 +1,22 @@
+//
+//  sys/time.h
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+#ifndef Host_sys_time_h
+#define Host_sys_time_h
+
+#include_next <sys/time.h>
+
+// The system clock as the node under test sees it, so a test can decide when
+// (and how well) each node has NTP time. Seconds before kEPOCH_01012022 read
+// as not synced yet.
+
+int hostGettimeofday(struct timeval *tv, void *tz);
+
+#define gettimeofday(tv, tz)    hostGettimeofday(tv, tz)
+
+#endif
@@ -0,0 +1,250 @@
+//
+//  sync_sim.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+// Runs several SyncClocks in one process against a simulated LAN (see
+// host/WiFiUdp.h) and checks that they agree on the time effects are rendered
+// from. Each node's micros64() runs from its own boot with its own crystal
+// error, and each node's NTP time (if it has any) is off by its own amount.
+//
+// Scenarios:
+//
+//  ntp             every node has NTP, the lowest chip ID leads
+//  leader no ntp   the leader has no NTP yet so everyone follows its raw
+//                  micros64(); when it gets NTP everyone steps to it
+//  leader lost     the leader drops off and the next lowest chip ID takes over
+
+#include "SyncClock.h"
+#include "config.h"
+#include <sys/time.h>
+#include <memory>
+#include <vector>
+
+#define kSIM_STEP_US        1000                // how often each node's loop() runs
+#define kSIM_EPOCH_S        1790000000LL        // true wall clock when the simulation starts
+#define kMAX_SPREAD_US      2000                // nodes must agree this closely once settled (now() is in mS)
+#define kFRAME_PERIOD_MS    2000                // phase compared as an effect with this period would see it
+
+typedef struct {
+    uint32_t                    chipID;
+    uint64_t                    bootAt;         // true µS
+    double                      driftPPM;
+    bool                        hasNTP;
+    int64_t                     ntpError;       // µS
+    bool                        running;
+    std::unique_ptr<SyncClock>  clock;
+} SimNodeRec, *SimNodePtr;
+
+static SimNodePtr   curNode = nullptr;
+
+static uint64_t localTime(SimNodePtr node) {
+    return (uint64_t)((double)(hostTime - node->bootAt) * (1.0 + node->driftPPM / 1000000.0));
+}
+
+static void selectNode(SimNodePtr node) {
+    curNode = node;
+    hostMicros = localTime(node);
+}
+
+int hostGettimeofday(struct timeval *tv, void *tz) {
+    int64_t     wall = (int64_t)localTime(curNode);         // seconds since boot until NTP arrives
+
+    if (curNode->hasNTP) {
+        wall = kSIM_EPOCH_S * 1000000LL + (int64_t)hostTime + curNode->ntpError;
+    }
+    tv->tv_sec = wall / 1000000;
+    tv->tv_usec = wall % 1000000;
+
+    return 0;
+}
+
+class SyncSim {
+public:
+    SyncSim(const char *inName) : name(inName) { hostTime = 0; }
+
+    void addNode(uint32_t chipID, uint64_t bootAt, double driftPPM, bool hasNTP, int64_t ntpError) {
+        SimNodePtr  node = new SimNodeRec();
+
+        node->chipID = chipID;
+        node->bootAt = bootAt;
+        node->driftPPM = driftPPM;
+        node->hasNTP = hasNTP;
+        node->ntpError = ntpError;
+        node->running = false;
+        nodes.emplace_back(node);
+    }
+
+    SimNodePtr node(uint32_t chipID) {
+        for (std::unique_ptr<SimNodeRec> &node : nodes) {
+            if (node->chipID == chipID) {
+                return node.get();
+            }
+        }
+
+        return nullptr;
+    }
+
+    // Steps every running node until untilS. Once past checkFromS, the spread
+    // of now() across running nodes is tracked along with how far the group is
+    // from true NTP time.
+    void run(double untilS, double checkFromS) {
+        uint64_t    until = untilS * 1000000.0;
+        uint64_t    checkFrom = checkFromS * 1000000.0;
+
+        maxSpread = 0;
+        maxPhaseSpread = 0.0;
+        maxTrueError = 0;
+        for (; hostTime < until; hostTime += kSIM_STEP_US) {
+            for (std::unique_ptr<SimNodeRec> &node : nodes) {
+                if (!node->clock && hostTime >= node->bootAt) {
+                    hostChipID = node->chipID;
+                    selectNode(node.get());
+                    node->clock.reset(new SyncClock());
+                    node->running = true;
+                }
+                if (node->running) {
+                    selectNode(node.get());
+                    node->clock->loop();
+                }
+            }
+
+            if (hostTime >= checkFrom && hostTime % 100000 == 0) {
+                measure();
+            }
+        }
+    }
+
+    void stop(uint32_t chipID) { node(chipID)->running = false; }     // powered off, stays down
+
+    uint32_t leaderAgreed() {
+        uint32_t    leader = 0;
+
+        for (std::unique_ptr<SimNodeRec> &node : nodes) {
+            if (node->running) {
+                uint32_t    nodeLeader = node->clock->getStats().leaderID;
+
+                if (leader != 0 && nodeLeader != leader) {
+                    return 0;
+                }
+                leader = nodeLeader;
+            }
+        }
+
+        return leader;
+    }
+
+    const char  *name;
+    int64_t     maxSpread;          // µS
+    double      maxPhaseSpread;     // fraction of kFRAME_PERIOD_MS
+    int64_t     maxTrueError;       // µS from true wall clock, meaningful once the leader has NTP
+
+private:
+    void measure() {
+        int64_t     lo = INT64_MAX, hi = INT64_MIN;
+        double      phaseLo = 1.0, phaseHi = 0.0;
+        int64_t     trueError = 0;
+
+        for (std::unique_ptr<SimNodeRec> &node : nodes) {
+            if (node->running) {
+                uint64_t    nowMS;
+                double      phase;
+
+                selectNode(node.get());
+                nowMS = node->clock->now();
+                phase = (double)(nowMS % kFRAME_PERIOD_MS) / kFRAME_PERIOD_MS;     // as PixelController::framePhase
+                trueError = max(trueError, (int64_t)llabs((int64_t)nowMS * 1000 - (kSIM_EPOCH_S * 1000000LL + (int64_t)hostTime)));
+                lo = min(lo, (int64_t)nowMS * 1000);
+                hi = max(hi, (int64_t)nowMS * 1000);
+                phaseLo = min(phaseLo, phase);
+                phaseHi = max(phaseHi, phase);
+            }
+        }
+
+        maxSpread = max(maxSpread, hi - lo);
+        if (phaseHi - phaseLo < 0.5) {      // not straddling the wrap
+            maxPhaseSpread = max(maxPhaseSpread, phaseHi - phaseLo);
+        }
+        maxTrueError = max(maxTrueError, trueError);
+    }
+
+    std::vector<std::unique_ptr<SimNodeRec>>    nodes;
+};
+
+static int failures = 0;
+
+static void check(bool passed, const char *scenario, const char *what) {
+    printf("  %-4s %s: %s\n", passed ? "ok" : "FAIL", scenario, what);
+    if (!passed) {
+        failures++;
+    }
+}
+
+static void report(SyncSim &sim, const char *phase) {
+    printf("%-14s %-12s spread %5lld µS, phase spread %.5f, from NTP time %lld µS, leader %08x\n", sim.name, phase,
+        (long long)sim.maxSpread, sim.maxPhaseSpread, (long long)sim.maxTrueError, sim.leaderAgreed());
+}
+
+static void allNTP() {
+    SyncSim     sim("ntp");
+
+    sim.addNode(0x1001, 0, 40.0, true, 3000);
+    sim.addNode(0x2002, 1700000, -25.0, true, -4000);
+    sim.addNode(0x3003, 3100000, 60.0, true, 1000);
+
+    sim.run(120.0, 30.0);
+    report(sim, "settled");
+    check(sim.leaderAgreed() == 0x1001, sim.name, "all nodes follow the lowest chip ID");
+    check(sim.maxSpread <= kMAX_SPREAD_US, sim.name, "nodes agree on now()");
+    check(sim.maxTrueError <= 3000 + kMAX_SPREAD_US, sim.name, "group tracks the leader's NTP time");
+}
+
+static void leaderWithoutNTP() {
+    SyncSim     sim("leader no ntp");
+
+    sim.addNode(0x1001, 2500000, 40.0, false, 0);
+    sim.addNode(0x2002, 0, -25.0, true, -4000);
+    sim.addNode(0x3003, 900000, 60.0, true, 1000);
+
+    sim.run(60.0, 20.0);
+    report(sim, "raw time");
+    check(sim.leaderAgreed() == 0x1001, sim.name, "followers lock onto the leader without NTP");
+    check(sim.maxSpread <= kMAX_SPREAD_US, sim.name, "nodes agree on the leader's raw micros64()");
+
+    sim.node(0x1001)->hasNTP = true;
+    sim.node(0x1001)->ntpError = 2000;
+    sim.run(120.0, 75.0);
+    report(sim, "after ntp");
+    check(sim.maxSpread <= kMAX_SPREAD_US, sim.name, "nodes agree again once the leader has NTP");
+    check(sim.maxTrueError <= 2000 + kMAX_SPREAD_US, sim.name, "group steps to the leader's NTP time");
+}
+
+static void leaderLost() {
+    SyncSim     sim("leader lost");
+
+    sim.addNode(0x1001, 0, 40.0, true, 3000);
+    sim.addNode(0x2002, 1700000, -25.0, true, -4000);
+    sim.addNode(0x3003, 3100000, 60.0, true, 1000);
+
+    sim.run(40.0, 20.0);
+    report(sim, "before");
+    sim.stop(0x1001);
+    sim.run(120.0, 60.0);
+    report(sim, "after");
+    check(sim.leaderAgreed() == 0x2002, sim.name, "the next lowest chip ID takes over");
+    check(sim.maxSpread <= kMAX_SPREAD_US, sim.name, "remaining nodes agree on now()");
+    check(sim.maxTrueError <= 4000 + kMAX_SPREAD_US, sim.name, "group tracks the new leader's NTP time");
+}
+
+int main(int argc, char *argv[]) {
+    allNTP();
+    leaderWithoutNTP();
+    leaderLost();
+
+    printf("%s\n", failures ? "sync_sim: FAILED" : "sync_sim: passed");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+//
+//  upload_test.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+// Drives UploadStager the way FileServerHandler does, against the RAM backed
+// LittleFS in host/, and checks that the destination is only ever the old file
+// or the whole new one.
+
+#include "UploadStager.h"
+
+static int failures = 0;
+
+static void check(bool passed, const char *what) {
+    printf("  %-4s %s\n", passed ? "ok" : "FAIL", what);
+    if (!passed) {
+        failures++;
+    }
+}
+
+static HostFileData pattern(size_t len, uint8_t seed) {
+    HostFileData    data(len);
+
+    for (size_t i=0; i<len; i++) {
+        data[i] = (uint8_t)(seed + i * 7);
+    }
+
+    return data;
+}
+
+static size_t tempFileCount() {
+    size_t  count = 0;
+
+    for (auto &entry : hostFiles) {
+        if (entry.first.compare(0, strlen(kUPLOAD_TEMP_PREFIX), kUPLOAD_TEMP_PREFIX) == 0) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static void reset() {
+    hostFiles.clear();
+    hostFSFree = SIZE_MAX;
+    hostFiles["/index.html"] = pattern(3000, 1);
+}
+
+// Sends data in pieces of up to chunkLen, as the TCP callbacks would. Stops
+// after stopAfter bytes without the final call if stopAfter is less than the
+// whole file.
+
+static void upload(UploadStatePtr state, File &file, const char *name, const HostFileData &data, size_t chunkLen, size_t stopAfter = SIZE_MAX) {
+    size_t  index = 0;
+
+    UploadStager::beginFile(state, file, name);
+    while (index < data.size() && index < stopAfter) {
+        size_t  len = min(chunkLen, data.size() - index);
+
+        UploadStager::append(state, file, data.data() + index, len);
+        index += len;
+    }
+    if (index == data.size()) {
+        UploadStager::finishFile(state, file);
+    }
+}
+
+static void completeReplace() {
+    UploadStateRec  state;
+    File            file;
+    HostFileData    data = pattern(5000, 9);
+
+    reset();
+    UploadStager::begin(&state);
+    upload(&state, file, "index.html", data, 1460);
+    check(hostFiles["/index.html"] == data, "a complete upload replaces the file");
+    check(tempFileCount() == 0, "a complete upload leaves no temp file");
+    check(!state.failed && state.fileCount == 1 && state.totalBytes == data.size(), "a complete upload is counted");
+}
+
+static void interruptedUpload() {
+    UploadStateRec  state;
+    File            file;
+    HostFileData    old;
+
+    reset();
+    old = hostFiles["/index.html"];
+    UploadStager::begin(&state);
+    upload(&state, file, "/index.html", pattern(5000, 9), 1460, 2920);
+    file.abandon();         // the client went away or the power failed
+    check(hostFiles["/index.html"] == old, "an interrupted upload leaves the old file");
+    check(tempFileCount() == 1, "an interrupted upload leaves a temp file");
+
+    UploadStager::removeStale();
+    check(tempFileCount() == 0 && hostFiles["/index.html"] == old, "the temp file is swept up at startup");
+}
+
+static void staleUploads() {
+    reset();
+    for (int i=0; i<kUPLOAD_STALE_BATCH * 2 + 3; i++) {
+        char    path[kUPLOAD_TEMP_LEN];
+
+        snprintf(path, sizeof(path), kUPLOAD_TEMP_PREFIX "%04x", i);
+        hostFiles[path] = pattern(10, i);
+    }
+    hostFiles["/.upper-case-names-are-fine.txt"] = pattern(10, 0);     // shares the prefix but is too long to be a temp name
+
+    UploadStager::removeStale();
+    check(tempFileCount() == 1, "every stale temp file is removed");
+    check(hostFiles.count("/.upper-case-names-are-fine.txt") == 1 && hostFiles.count("/index.html") == 1, "other files are kept");
+}
+
+static void failedWrite() {
+    UploadStateRec  state;
+    File            file;
+    HostFileData    old;
+
+    reset();
+    old = hostFiles["/index.html"];
+    hostFSFree = 2048;
+    UploadStager::begin(&state);
+    upload(&state, file, "index.html", pattern(5000, 9), 1460);
+    check(hostFiles["/index.html"] == old, "a failed write keeps the old file");
+    check(tempFileCount() == 0, "a failed write removes its temp file");
+    check(state.failed && state.fileCount == 0, "a failed write is reported");
+}
+
+int main(int argc, char *argv[]) {
+    completeReplace();
+    interruptedUpload();
+    staleUploads();
+    failedWrite();
+
+    printf("%s\n", failures ? "upload_test: FAILED" : "upload_test: passed");
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,21 @@
+#!/bin/sh
+#
+#  gzip_data.sh
+#  KLights
+#
+#  Pre-compresses the text assets in data/ so the web server can send the .gz
+#  variant with Content-Encoding: gzip. Originals are kept so the file manager
+#  and clients that don't accept gzip still work. Run before uploading the
+#  LittleFS image.
+#
+#  Usage: tools/gzip_data.sh [data_dir]
+
+DATA_DIR="${1:-$(dirname "$0")/../data}"
+
+for file in "$DATA_DIR"/*.html "$DATA_DIR"/*.css "$DATA_DIR"/*.js "$DATA_DIR"/*.svg "$DATA_DIR"/*.json; do
+    [ -f "$file" ] || continue
+
+    # -n omits the name and timestamp so output only changes with content
+    gzip -9 -n -c "$file" > "$file.gz"
+    echo "$(basename "$file"): $(wc -c < "$file") -> $(wc -c < "$file.gz") bytes"
+done
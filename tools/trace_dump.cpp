@@ -0,0 +1,119 @@
+//
+//  trace_dump.cpp
+//  KLights
+//
+//  Created by Casey Fleser on 10/18/2026.
+//  Copyright © 2026 Casey Fleser. All rights reserved.
+//
+
+// Prints a command trace (see TraceFormat.h) recorded by /$trace?record= so a
+// trace can be read or diffed on a host. Fetch it from the device first, e.g.
+// curl -o evening.klt http://klights.local/evening.klt
+//
+// Build: c++ -std=c++11 -o trace_dump tools/trace_dump.cpp
+// Usage: trace_dump [-j] file.klt
+//
+//  -j      one JSON object per record (time, source, topic, payload) instead
+//          of a table, for scripts
+//
+// Replaying a trace still happens on the device (/$trace?replay=), since the
+// handlers it feeds need the ESP8266 core and ArduinoJson. The records are
+// checked against the same limits CommandTrace::readRecord uses, so a trace
+// this reads cleanly is one the device will replay. Assumes a little endian
+// host, as the ESP8266 is.
+
+#include "../TraceFormat.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *const sourceNames[trace_source_count] = { "mqtt", "restore", "web" };
+
+// Anything that isn't printable ASCII is escaped so the output stays one line
+// per record
+
+static void printEscaped(const char *text, size_t len, bool json) {
+    for (size_t i=0; i<len; i++) {
+        unsigned char   c = text[i];
+
+        if (json && (c == '"' || c == '\\')) {
+            printf("\\%c", c);
+        }
+        else if (c < 0x20 || c >= 0x7f) {
+            printf(json ? "\\u%04x" : "\\x%02x", c);
+        }
+        else {
+            putchar(c);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool            json = argc == 3 && !strcmp(argv[1], "-j");
+    const char      *path = argv[argc - 1];
+    FILE            *file;
+    TraceHeaderRec  header;
+    TraceRecordRec  record;
+    char            topic[kTRACE_MAX_TOPIC];
+    char            payload[kTRACE_MAX_PAYLOAD];
+    uint32_t        count = 0;
+
+    if (argc != 2 && !json) {
+        fprintf(stderr, "usage: %s [-j] file.klt\n", argv[0]);
+        return 2;
+    }
+
+    if ((file = fopen(path, "rb")) == nullptr) {
+        perror(path);
+        return 1;
+    }
+
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != kTRACE_MAGIC) {
+        fprintf(stderr, "%s: not a trace\n", path);
+        fclose(file);
+        return 1;
+    }
+    if (header.version != kTRACE_VERSION) {
+        fprintf(stderr, "%s: version %u, expected %u\n", path, header.version, kTRACE_VERSION);
+        fclose(file);
+        return 1;
+    }
+
+    if (!json) {
+        printf("%s: %u records over %.1fs\n", path, header.recordCount, header.duration / 1000.0);
+        printf("%10s  %-8s %s\n", "time", "source", "topic / payload");
+    }
+
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        if (record.source >= trace_source_count || record.topicLen > kTRACE_MAX_TOPIC || record.payloadLen > kTRACE_MAX_PAYLOAD ||
+            fread(topic, 1, record.topicLen, file) != record.topicLen || fread(payload, 1, record.payloadLen, file) != record.payloadLen) {
+            fprintf(stderr, "%s: bad record %u at offset %ld\n", path, count, ftell(file));
+            break;
+        }
+
+        if (json) {
+            printf("{ \"time\": %u, \"source\": \"%s\", \"topic\": \"", record.time, sourceNames[record.source]);
+            printEscaped(topic, record.topicLen, true);
+            printf("\", \"payload\": \"");
+            printEscaped(payload, record.payloadLen, true);
+            printf("\" }\n");
+        }
+        else {
+            printf("%9.3fs  %-8s ", record.time / 1000.0, sourceNames[record.source]);
+            if (record.topicLen) {
+                printEscaped(topic, record.topicLen, false);
+                putchar(' ');
+            }
+            printEscaped(payload, record.payloadLen, false);
+            putchar('\n');
+        }
+        count++;
+    }
+    fclose(file);
+
+    if (count != header.recordCount) {
+        fprintf(stderr, "%s: read %u of %u records\n", path, count, header.recordCount);
+        return 1;
+    }
+
+    return 0;
+}